@@ -1,9 +1,12 @@
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 #include <unordered_map>
 #include <string>
 
 #include "baseboard.h"
+#include "fen.h"
+#include "positiontables.h"
 
 int lsb(BitBoard bb){
     return __builtin_ffsll(bb)-1;
@@ -118,6 +121,30 @@ void printBitBoard(BitBoard bb){
     }
 }
 
+// Material and piece-square value of every piece on every square, for
+// the middlegame and the endgame
+struct PieceSquareTable{
+    int mg[7][64];
+    int eg[7][64];
+
+    PieceSquareTable(){
+        const int16_t* mg_tables[7] = {nullptr, mg_pawn_table, mg_knight_table, mg_bishop_table, mg_rook_table, mg_queen_table, mg_king_table};
+        const int16_t* eg_tables[7] = {nullptr, eg_pawn_table, eg_knight_table, eg_bishop_table, eg_rook_table, eg_queen_table, eg_king_table};
+
+        for(int square = 0; square < 64; square++){
+            mg[NO_PIECE][square] = 0;
+            eg[NO_PIECE][square] = 0;
+
+            for(int piecetype = PAWN; piecetype <= KING; piecetype++){
+                mg[piecetype][square] = mg_material[piecetype] + mg_tables[piecetype][square];
+                eg[piecetype][square] = eg_material[piecetype] + eg_tables[piecetype][square];
+            }
+        }
+    }
+};
+
+const PieceSquareTable PSQ_TABLE;
+
 bool BaseBoard::initialized_attacks = false;
 
 BitBoard BaseBoard::BB_KING_ATTACKS[64];
@@ -143,7 +170,7 @@ BaseBoard::BaseBoard(){
     }
 }
 
-BaseBoard::BaseBoard(std::string fen){
+BaseBoard::BaseBoard(std::string_view fen){
     resetBoard();
 
     if(!initialized_attacks){
@@ -201,6 +228,9 @@ void BaseBoard::resetBoard(){
     occupied_color[WHITE] = BB_RANK_1 | BB_RANK_2;
     occupied_color[BLACK] = BB_RANK_7 | BB_RANK_8;
     occupied = BB_RANK_1 | BB_RANK_2 | BB_RANK_7 | BB_RANK_8;
+
+    computeScores();
+    resetAccumulators();
 }
 
 // Empty board
@@ -215,76 +245,89 @@ void BaseBoard::clearBoard(){
     occupied_color[WHITE] = BB_EMPTY;
     occupied_color[BLACK] = BB_EMPTY;
     occupied = BB_EMPTY;
+
+    computeScores();
+    resetAccumulators();
 }
 
-void BaseBoard::setBoardFEN(std::string fen){
-    clearBoard();
+void BaseBoard::setBoardFEN(std::string_view fen){
+    FENError error;
+    if(!parseBoardFEN(fen.substr(0, fen.find(' ')), *this, error)){
+        throw std::invalid_argument(error.message);
+    }
+}
 
-    int rank = 7;
-    int file = 0;
-    int i = 0;
+void BaseBoard::updateScores(Square square, PieceType piecetype, Color color, int sign){
+    mg_score[color][0] += sign * PSQ_TABLE.mg[piecetype][square];
+    mg_score[color][1] += sign * PSQ_TABLE.mg[piecetype][63 - square];
+    eg_score[color][0] += sign * PSQ_TABLE.eg[piecetype][square];
+    eg_score[color][1] += sign * PSQ_TABLE.eg[piecetype][63 - square];
+    game_phase += sign * phase_weights[piecetype];
+}
 
-    while(i < fen.length() && fen.at(i) != ' '){
-        switch(fen.at(i)){
-            case '/':
-                rank--;
-                file = 0;
-                break;
-            case 'P':
-                setPieceAt(8*rank+file, PAWN, WHITE);
-                file++;
-                break;
-            case 'p':
-                setPieceAt(8*rank+file, PAWN, BLACK);
-                file++;
-                break;
-            case 'N':
-                setPieceAt(8*rank+file, KNIGHT, WHITE);
-                file++;
-                break;
-            case 'n':
-                setPieceAt(8*rank+file, KNIGHT, BLACK);
-                file++;
-                break;
-            case 'B':
-                setPieceAt(8*rank+file, BISHOP, WHITE);
-                file++;
-                break;
-            case 'b':
-                setPieceAt(8*rank+file, BISHOP, BLACK);
-                file++;
-                break;
-            case 'R':
-                setPieceAt(8*rank+file, ROOK, WHITE);
-                file++;
-                break;
-            case 'r':
-                setPieceAt(8*rank+file, ROOK, BLACK);
-                file++;
-                break;
-            case 'Q':
-                setPieceAt(8*rank+file, QUEEN, WHITE);
-                file++;
-                break;
-            case 'q':
-                setPieceAt(8*rank+file, QUEEN, BLACK);
-                file++;
-                break;
-            case 'K':
-                setPieceAt(8*rank+file, KING, WHITE);
-                file++;
-                break;
-            case 'k':
-                setPieceAt(8*rank+file, KING, BLACK);
-                file++;
-                break;
-            default:
-                file += fen.at(i)-'0';
+// Score every piece from scratch, for boards set up without setPieceAt
+void BaseBoard::computeScores(){
+    for(int color = 0; color < 2; color++){
+        for(int i = 0; i < 2; i++){
+            mg_score[color][i] = 0;
+            eg_score[color][i] = 0;
         }
-        i++;
+    }
+    game_phase = 0;
+
+    BitBoard bb = occupied;
+    while(bb){
+        Square square = lsb(bb);
+        updateScores(square, pieceTypeAt(square), colorAt(square), 1);
+        bb &= (bb - 1);
     }
 }
 
+// Forget all accumulators, the next NNUE evaluation refreshes from scratch
+void BaseBoard::resetAccumulators(){
+    if(accumulators.empty()){
+        accumulators.emplace_back();
+    }
+    accumulator_top = 0;
+    accumulators[0].computed[WHITE] = false;
+    accumulators[0].computed[BLACK] = false;
+    accumulators[0].dirty_count = 0;
+    accumulators[0].overflow = false;
+}
+
+// Start the accumulator of a new move, entries are reused once allocated
+void BaseBoard::pushAccumulator(){
+    accumulator_top++;
+    if(accumulator_top == (int)accumulators.size()){
+        accumulators.emplace_back();
+    }
+
+    Accumulator& accumulator = accumulators[accumulator_top];
+    accumulator.computed[WHITE] = false;
+    accumulator.computed[BLACK] = false;
+    accumulator.dirty_count = 0;
+    accumulator.overflow = false;
+}
+
+void BaseBoard::popAccumulator(){
+    accumulator_top--;
+}
+
+// Changes outside of a move (board setup) are not tracked, the first
+// accumulator is always refreshed
+void BaseBoard::recordDirtyPiece(Square square, PieceType piecetype, Color color, bool added){
+    if(accumulator_top == 0){
+        return;
+    }
+
+    Accumulator& accumulator = accumulators[accumulator_top];
+    if(accumulator.dirty_count == MAX_DIRTY_PIECES){
+        accumulator.overflow = true;
+        return;
+    }
+    accumulator.dirty[accumulator.dirty_count++] = DirtyPiece{square, piecetype, color, added};
+}
+
 PieceType BaseBoard::removePieceAt(Square square){
     PieceType piecetype = pieceTypeAt(square);
     BitBoard mask = BB_SQUARES[square];
@@ -318,6 +361,10 @@ PieceType BaseBoard::removePieceAt(Square square){
             return NO_PIECE;
     }
 
+    Color color = (occupied_color[WHITE] & mask) ? WHITE : BLACK;
+    updateScores(square, piecetype, color, -1);
+    recordDirtyPiece(square, piecetype, color, false);
+
     occupied ^= mask;
     occupied_color[WHITE] &= ~mask;
     occupied_color[BLACK] &= ~mask;
@@ -361,6 +408,9 @@ void BaseBoard::setPieceAt(Square square, PieceType piecetype, Color color){
 
     occupied ^= mask;
     occupied_color[color] ^= mask;
+
+    updateScores(square, piecetype, color, 1);
+    recordDirtyPiece(square, piecetype, color, true);
 }
 
 // Returns BitBoard mask of squares with PieceType and Color
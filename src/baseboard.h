@@ -2,8 +2,11 @@
 
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "constants.h"
+#include "nnue.h"
 
 int lsb(BitBoard bb);
 int msb(BitBoard bb);
@@ -25,6 +28,12 @@ class BaseBoard{
         static BitBoard BB_RAYS[64][64];
         static std::unordered_map<BitBoard, BitBoard> BB_DIAG_ATTACKS[64], BB_FILE_ATTACKS[64], BB_RANK_ATTACKS[64];
 
+        void updateScores(Square square, PieceType piecetype, Color color, int sign);
+        void computeScores();
+
+        void recordDirtyPiece(Square square, PieceType piecetype, Color color, bool added);
+        void resetAccumulators();
+
         static BitBoard ray(Square a, Square b);
         static BitBoard between(Square a, Square b);
 
@@ -34,13 +43,32 @@ class BaseBoard{
 
         BitBoard pawns, knights, bishops, rooks, queens, kings;
 
-        BaseBoard(std::string fen);
+        // Material plus piece-square score of each color, once with the
+        // tables read from a1 (index 0) and once from h8 (index 1), and the
+        // game phase of both sides. setPieceAt and removePieceAt keep them
+        // up to date, so evaluation never walks the bitboards.
+        int mg_score[2][2];
+        int eg_score[2][2];
+        int game_phase;
+
+        // NNUE accumulators of this position and every position before it
+        // since the board was set up. Entry i differs from entry i - 1 by the
+        // dirty pieces of one move; evaluateNNUE computes them on demand.
+        mutable std::vector<Accumulator> accumulators;
+        int accumulator_top;
+
+        void pushAccumulator();
+        void popAccumulator();
+
+        BaseBoard(std::string_view fen);
         BaseBoard();
 
         void resetBoard();
         void clearBoard();
 
-        void setBoardFEN(std::string fen);
+        // Throws std::invalid_argument naming the problem when the
+        // placement is malformed, see parseBoardFEN for the details
+        void setBoardFEN(std::string_view fen);
 
         PieceType removePieceAt(Square square);
         void setPieceAt(Square square, PieceType piecetype, Color color);
@@ -0,0 +1,343 @@
+#include "batch.h"
+#include "board.h"
+#include "fen.h"
+#include "nnue.h"
+#include "syzygy.h"
+#include "threadpool.h"
+#include "uci.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct BatchOptions{
+    SearchLimits limits;
+    int workers = std::max(1, (int)std::thread::hardware_concurrency());
+    int hash_mb = BATCH_DEFAULT_HASH_MB;
+};
+
+struct BatchLine{
+    std::string_view text;
+    size_t number;
+};
+
+// Finished results wait here until every earlier line has been written
+struct BatchResults{
+    std::vector<std::string> json;
+    std::vector<char> ready;
+
+    std::mutex mutex;
+    std::condition_variable ready_cv;
+};
+
+// Non-blank lines of the mapped file, without line endings
+std::vector<BatchLine> splitLines(const char* data, size_t size){
+    std::vector<BatchLine> lines;
+    size_t start = 0, number = 1;
+    while(start < size){
+        const char* newline = (const char*)std::memchr(data + start, '\n', size - start);
+        size_t end = newline ? newline - data : size;
+
+        std::string_view text(data + start, end - start);
+        while(!text.empty() && (text.back() == '\r' || text.back() == ' ' || text.back() == '\t')){
+            text.remove_suffix(1);
+        }
+        if(!text.empty()){
+            lines.push_back(BatchLine{text, number});
+        }
+
+        start = end + 1;
+        number++;
+    }
+    return lines;
+}
+
+void putJSONString(std::ostringstream& out, std::string_view s){
+    out << '"';
+    for(char c: s){
+        if(c == '"' || c == '\\'){
+            out << '\\' << c;
+        } else if ((unsigned char)c < 0x20){
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// A line is tried as a FEN first and then as EPD; when both fail the error
+// that got further into the line is the one reported
+bool parseLine(std::string_view line, Board& b, EPDRecord& record, FENError& error){
+    record = EPDRecord();
+    if(parseFEN(line, b, error)){
+        return true;
+    }
+
+    FENError epd_error;
+    if(parseEPD(line, b, record, epd_error)){
+        return true;
+    }
+    if(epd_error.offset >= error.offset){
+        error = epd_error;
+    }
+    return false;
+}
+
+// bm and am of an EPD test position, false when the move was not resolved
+// as one of the best moves or was one of the moves to avoid
+bool solved(const Board& b, const EPDRecord& record, const Move& move){
+    Move m;
+    for(int i = 0; i < record.avoid_move_count; i++){
+        if(b.parseSAN(record.avoid_moves[i], m) && m == move){
+            return false;
+        }
+    }
+    for(int i = 0; i < record.best_move_count; i++){
+        if(b.parseSAN(record.best_moves[i], m) && m == move){
+            return true;
+        }
+    }
+    return record.best_move_count == 0;
+}
+
+std::string analyseLine(const BatchLine& line, const BatchOptions& options, const ZobristTable& table,
+                        TranspositionTable& transposition_table, uint64_t& nodes){
+    std::ostringstream out;
+    out << "{\"line\":" << line.number;
+
+    Board b;
+    EPDRecord record;
+    FENError error;
+    if(!parseLine(line.text, b, record, error)){
+        out << ",\"error\":";
+        putJSONString(out, error.message);
+        out << ",\"offset\":" << error.offset << "}";
+        return out.str();
+    }
+
+    if(!record.id.empty()){
+        out << ",\"id\":";
+        putJSONString(out, record.id);
+    }
+
+    // every position is searched from an empty table, so results do not
+    // depend on which worker got which lines
+    transposition_table.clear();
+
+    auto start = std::chrono::steady_clock::now();
+    SearchInfo info;
+    Board search_board = b;
+    std::pair<int, Move> best = searchIterative(search_board, options.limits, table, transposition_table, &info);
+    int elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    nodes += info.nodes + info.qnodes;
+
+    if(best.second == NO_MOVE){
+        out << ",\"bestmove\":null,\"score\":" << (b.isCheck() ? -MATE_SCORE : 0);
+    } else {
+        char uci[UCI_MAX_LENGTH];
+        char san[SAN_MAX_LENGTH];
+        best.second.writeUCI(uci);
+        b.writeSAN(best.second, san);
+        out << ",\"bestmove\":\"" << uci << "\",\"san\":\"" << san << "\",\"score\":" << best.first;
+    }
+
+    // a single legal move is played without searching
+    if(info.forced){
+        out << ",\"forced\":true";
+    }
+
+    out << ",\"depth\":" << info.depth
+        << ",\"seldepth\":" << info.seldepth
+        << ",\"nodes\":" << info.nodes
+        << ",\"qnodes\":" << info.qnodes
+        << ",\"time\":" << elapsed_ms
+        << ",\"pv\":[";
+    char uci[UCI_MAX_LENGTH];
+    for(size_t i = 0; i < info.pv.size(); i++){
+        info.pv.at(i).writeUCI(uci);
+        out << (i ? "," : "") << "\"" << uci << "\"";
+    }
+    out << "]";
+
+    if(record.best_move_count || record.avoid_move_count){
+        out << ",\"solved\":" << (solved(b, record, best.second) ? "true" : "false");
+    }
+
+    out << "}";
+    return out.str();
+}
+
+bool parseBatchOptions(int argc, char* argv[], BatchOptions& options){
+    try{
+        for(int i = 1; i + 1 < argc; i += 2){
+            std::string name = argv[i];
+            std::string value = argv[i + 1];
+
+            if(name == "depth"){
+                options.limits.depth = std::clamp(std::stoi(value), 1, MAX_DEPTH);
+            } else if (name == "nodes"){
+                options.limits.nodes = std::stoull(value);
+            } else if (name == "movetime"){
+                options.limits.movetime = std::max(1, std::stoi(value));
+            } else if (name == "workers"){
+                options.workers = std::max(1, std::stoi(value));
+            } else if (name == "hash"){
+                options.hash_mb = std::clamp(std::stoi(value), 1, UCI_MAX_HASH_MB);
+            } else if (name == "evalfile"){
+                if(!loadNetwork(value)){
+                    std::cerr << "Could not load network from " << value << std::endl;
+                    return false;
+                }
+                search_options.use_nnue = true;
+            } else if (name == "syzygypath"){
+                std::cerr << "Found " << initTablebases(value) << " tablebases in " << value << std::endl;
+            } else {
+                std::cerr << "Unknown batch option " << name << std::endl;
+                return false;
+            }
+        }
+        if(argc % 2 == 0){
+            std::cerr << "Missing value for " << argv[argc - 1] << std::endl;
+            return false;
+        }
+    } catch(const std::exception&){
+        std::cerr << "Invalid batch option value" << std::endl;
+        return false;
+    }
+
+    if(!options.limits.depth && !options.limits.nodes && !options.limits.movetime){
+        options.limits.depth = BATCH_DEFAULT_DEPTH;
+    }
+    return true;
+}
+
+int batchMain(int argc, char* argv[], const ZobristTable& table){
+    if(argc < 1){
+        std::cerr << "Usage: batch <file> [depth x] [nodes x] [movetime x] [workers x] [hash x] [evalfile <path>] [syzygypath <path>]" << std::endl;
+        return 1;
+    }
+
+    BatchOptions options;
+    if(!parseBatchOptions(argc, argv, options)){
+        return 1;
+    }
+
+    // one search thread per position leaves the Lazy SMP helper pool unused,
+    // so the workers share no mutable search state
+    search_options.threads = 1;
+    search_options.info_format = INFO_NONE;
+
+    int fd = open(argv[0], O_RDONLY);
+    if(fd < 0){
+        std::cerr << "Could not open " << argv[0] << std::endl;
+        return 1;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        std::cerr << "Could not read " << argv[0] << std::endl;
+        return 1;
+    }
+
+    size_t size = st.st_size;
+    void* mapping = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if(mapping == MAP_FAILED){
+        std::cerr << "Could not map " << argv[0] << std::endl;
+        return 1;
+    }
+    if(mapping){
+        madvise(mapping, size, MADV_SEQUENTIAL);
+    }
+
+    std::vector<BatchLine> lines = splitLines((const char*)mapping, size);
+
+    BatchResults results;
+    results.json.resize(lines.size());
+    results.ready.assign(lines.size(), 0);
+
+    int workers = std::min<int>(options.workers, std::max<size_t>(1, lines.size()));
+    std::vector<uint64_t> worker_nodes(workers, 0);
+    std::atomic<size_t> next_line(0);
+
+    // allocated here, where running out of memory can still be reported
+    std::vector<std::unique_ptr<TranspositionTable>> transposition_tables;
+    try{
+        for(int i = 0; i < workers; i++){
+            transposition_tables.push_back(std::make_unique<TranspositionTable>(options.hash_mb));
+        }
+    } catch(const std::bad_alloc&){
+        if(mapping){
+            munmap(mapping, size);
+        }
+        std::cerr << "Could not allocate " << options.hash_mb << " MB of hash for each of " << workers << " workers" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    ThreadPool pool;
+    pool.resize(workers);
+    pool.run([&](int index){
+        TranspositionTable& transposition_table = *transposition_tables.at(index);
+
+        size_t i;
+        while((i = next_line.fetch_add(1)) < lines.size()){
+            std::string json = analyseLine(lines.at(i), options, table, transposition_table, worker_nodes.at(index));
+
+            std::lock_guard<std::mutex> lock(results.mutex);
+            results.json.at(i) = std::move(json);
+            results.ready.at(i) = 1;
+            results.ready_cv.notify_one();
+        }
+    });
+
+    // results are written as soon as all lines before them are done
+    for(size_t i = 0; i < lines.size(); i++){
+        std::string json;
+        {
+            std::unique_lock<std::mutex> lock(results.mutex);
+            results.ready_cv.wait(lock, [&]{ return results.ready.at(i) != 0; });
+            json = std::move(results.json.at(i));
+        }
+        std::cout << json << "\n";
+    }
+    std::cout << std::flush;
+
+    pool.wait();
+
+    if(mapping){
+        munmap(mapping, size);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t nodes = 0;
+    for(uint64_t n: worker_nodes){
+        nodes += n;
+    }
+    std::cerr << lines.size() << " positions with " << workers << " workers in " << seconds << " s, "
+              << (uint64_t)(lines.size() / std::max(seconds, 1e-9)) << " positions/s, "
+              << (uint64_t)(nodes / std::max(seconds, 1e-9)) << " nps" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "engine.h"
+
+// depth searched when no depth, nodes or movetime is given
+const int BATCH_DEFAULT_DEPTH = 8;
+
+// transposition table of every worker, cleared before each position
+const int BATCH_DEFAULT_HASH_MB = 16;
+
+// Analyses a FEN/EPD file:
+//   batch <file> [depth x] [nodes x] [movetime x] [workers x] [hash x]
+//         [evalfile <path>] [syzygypath <path>]
+// The file is memory mapped and its positions are shared out among the
+// workers, each searching one position at a time on a single thread. One
+// JSON line per position is written to stdout in input order, marked
+// forced and not searched when there is a single legal move; a summary
+// goes to stderr. hash is clamped like the UCI Hash option. Returns the
+// exit code of the process.
+int batchMain(int argc, char* argv[], const ZobristTable& table);
@@ -0,0 +1,162 @@
+#include "bitbase.h"
+#include "board.h"
+
+#include <algorithm>
+#include <vector>
+
+// Retrograde classification states, combined as bit flags when collecting
+// the results of all moves from a position
+const uint8_t KPK_INVALID = 0;
+const uint8_t KPK_UNKNOWN = 1;
+const uint8_t KPK_DRAW = 2;
+const uint8_t KPK_WIN = 4;
+
+// Index of a position with the pawn on files a-d, ranks 2-7, from the
+// point of view of the side with the pawn (white). Generation calls this
+// millions of times, so file and rank are computed in place.
+inline int kpkIndex(Color turn, Square white_king, Square black_king, Square pawn){
+    return white_king | (black_king << 6) | ((turn == WHITE) << 12) | ((pawn & 7) << 13) | ((6 - (pawn >> 3)) << 15);
+}
+
+struct KPKBitbase{
+    uint64_t bits[KPK_SIZE / 64];
+
+    BitBoard king_attacks[64];
+    BitBoard pawn_attacks[64];
+
+    KPKBitbase(){
+        for(int s1 = 0; s1 < 64; s1++){
+            king_attacks[s1] = 0;
+            pawn_attacks[s1] = 0;
+            for(int s2 = 0; s2 < 64; s2++){
+                if(squareDistance(s1, s2) == 1){
+                    king_attacks[s1] |= BB_SQUARES[s2];
+                    if(squareRank(s2) == squareRank(s1) + 1 && squareFile(s2) != squareFile(s1)){
+                        pawn_attacks[s1] |= BB_SQUARES[s2];
+                    }
+                }
+            }
+        }
+
+        std::vector<uint8_t> results(KPK_SIZE);
+        std::vector<int> unknown;
+        for(int index = 0; index < KPK_SIZE; index++){
+            results[index] = classifyStatic(index);
+            if(results[index] == KPK_UNKNOWN){
+                unknown.push_back(index);
+            }
+        }
+
+        // a position is won once any white move wins or every black move
+        // loses, until nothing changes; what is left cannot be won. Each
+        // pass only revisits the positions still unknown.
+        size_t count = 0;
+        while(count != unknown.size()){
+            count = unknown.size();
+            unknown.erase(std::remove_if(unknown.begin(), unknown.end(), [&](int index){
+                results[index] = classify(index, results);
+                return results[index] != KPK_UNKNOWN;
+            }), unknown.end());
+        }
+
+        std::fill(bits, bits + KPK_SIZE / 64, 0);
+        for(int index = 0; index < KPK_SIZE; index++){
+            if(results[index] == KPK_WIN){
+                bits[index / 64] |= 1ULL << (index % 64);
+            }
+        }
+    }
+
+    static void decode(int index, Color& turn, Square& white_king, Square& black_king, Square& pawn){
+        white_king = index & 63;
+        black_king = (index >> 6) & 63;
+        turn = ((index >> 12) & 1) ? WHITE : BLACK;
+        pawn = ((6 - ((index >> 15) & 7)) << 3) | ((index >> 13) & 3);
+    }
+
+    // Illegal positions, immediate promotions, stalemates and pawn captures
+    uint8_t classifyStatic(int index) const{
+        Color turn;
+        Square white_king, black_king, pawn;
+        decode(index, turn, white_king, black_king, pawn);
+
+        if(white_king == black_king || (king_attacks[white_king] & BB_SQUARES[black_king]) || white_king == pawn || black_king == pawn ||
+           (turn == WHITE && (pawn_attacks[pawn] & BB_SQUARES[black_king]))){
+            return KPK_INVALID;
+        }
+
+        // the pawn promotes and the queen cannot be taken
+        Square queening = pawn + 8;
+        if(turn == WHITE && (pawn >> 3) == 6 && white_king != queening &&
+           ((black_king != queening && !(king_attacks[black_king] & BB_SQUARES[queening])) || (king_attacks[white_king] & BB_SQUARES[queening]))){
+            return KPK_WIN;
+        }
+
+        if(turn == BLACK){
+            BitBoard guarded = king_attacks[white_king] | pawn_attacks[pawn];
+            if(!(king_attacks[black_king] & ~guarded) || (king_attacks[black_king] & BB_SQUARES[pawn] & ~king_attacks[white_king])){
+                return KPK_DRAW;
+            }
+        }
+
+        return KPK_UNKNOWN;
+    }
+
+    uint8_t classify(int index, const std::vector<uint8_t>& results) const{
+        Color turn;
+        Square white_king, black_king, pawn;
+        decode(index, turn, white_king, black_king, pawn);
+
+        // moves into check or onto the other pieces lead to invalid indices,
+        // which add nothing
+        uint8_t reached = 0;
+        BitBoard moves = king_attacks[turn == WHITE ? white_king : black_king];
+        while(moves){
+            Square to = __builtin_ctzll(moves);
+            moves &= moves - 1;
+            reached |= (turn == WHITE) ? results[kpkIndex(BLACK, to, black_king, pawn)] : results[kpkIndex(WHITE, white_king, to, pawn)];
+        }
+
+        if(turn == WHITE){
+            if((pawn >> 3) < 6){
+                reached |= results[kpkIndex(BLACK, white_king, black_king, pawn + 8)];
+            }
+            if((pawn >> 3) == 1 && pawn + 8 != white_king && pawn + 8 != black_king){
+                reached |= results[kpkIndex(BLACK, white_king, black_king, pawn + 16)];
+            }
+        }
+
+        uint8_t good = (turn == WHITE) ? KPK_WIN : KPK_DRAW;
+        uint8_t bad = (turn == WHITE) ? KPK_DRAW : KPK_WIN;
+        return (reached & good) ? good : (reached & KPK_UNKNOWN) ? KPK_UNKNOWN : bad;
+    }
+
+    bool win(int index) const{
+        return (bits[index / 64] >> (index % 64)) & 1;
+    }
+};
+
+// Built during static initialization; it only depends on square geometry
+const KPKBitbase KPK_BITBASE;
+
+bool probeKPK(const Board& b){
+    Color strong = (b.pawns & b.occupied_color[WHITE]) ? WHITE : BLACK;
+
+    Square strong_king = b.king(strong);
+    Square weak_king = b.king(strong ^ 1);
+    Square pawn = lsb(b.pawns);
+
+    // black pawns are flipped to white ones, pawns on e-h to files a-d
+    if(strong == BLACK){
+        strong_king ^= 56;
+        weak_king ^= 56;
+        pawn ^= 56;
+    }
+    if(squareFile(pawn) > 3){
+        strong_king ^= 7;
+        weak_king ^= 7;
+        pawn ^= 7;
+    }
+
+    return KPK_BITBASE.win(kpkIndex(b.turn == strong ? WHITE : BLACK, strong_king, weak_king, pawn));
+}
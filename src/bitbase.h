@@ -0,0 +1,15 @@
+#pragma once
+
+#include "constants.h"
+
+class Board;
+
+// King and pawn versus king: every placement of the three pieces with the
+// pawn on files a-d and either side to move, one bit each, set when the
+// side with the pawn wins. Positions with the pawn on e-h or a black pawn
+// are mirrored onto it.
+const int KPK_SIZE = 2 * 24 * 64 * 64;
+
+// Whether the side with the pawn wins; the board must hold two kings and
+// a single pawn
+bool probeKPK(const Board& b);
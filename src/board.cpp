@@ -1,13 +1,16 @@
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <iostream>
-#include <sstream>
+#include <stdexcept>
 
 #include "board.h"
 #include "baseboard.h"
+#include "fen.h"
 #include "move.h"
 #include "constants.h"
 
-Board::Board(std::string fen){
+Board::Board(std::string_view fen){
     resetBoard();
     setBoardFEN(fen);
 }
@@ -49,6 +52,7 @@ void Board::push(const Move& move){
     // add current position to stack
     state_stack.push_back(BoardState(this));
     move_stack.push_back(move);
+    pushAccumulator();
 
     Square prev_ep_square = ep_square;
     ep_square = NO_SQUARE;
@@ -121,6 +125,22 @@ void Board::push(const Move& move){
     turn ^= 1;
 }
 
+// Pass the turn without moving, undone with pop like any other move
+void Board::pushNull(){
+    state_stack.push_back(BoardState(this));
+    move_stack.push_back(NULL_MOVE);
+    pushAccumulator();
+
+    ep_square = NO_SQUARE;
+
+    halfmove_clock++;
+    if(turn == BLACK){
+        fullmove_number++;
+    }
+
+    turn ^= 1;
+}
+
 Move Board::pop(){
     Move move = move_stack.back();
     move_stack.pop_back();
@@ -129,10 +149,19 @@ Move Board::pop(){
     state_stack.pop_back();
 
     bs.restore(this);
+    popAccumulator();
 
     return move;
 }
 
+// Last move pushed, NULL_MOVE after pushNull or NO_MOVE when there is none
+Move Board::peek() const{
+    if(move_stack.empty()){
+        return NO_MOVE;
+    }
+    return move_stack.back();
+}
+
 bool Board::attackedForKing(BitBoard path, BitBoard occupied_squares) const{
     while(path){
         if(attackersMask(turn ^ 1, lsb(path), occupied_squares)){
@@ -281,7 +310,7 @@ const std::vector<Move> Board::generatePseudoLegalMoves(BitBoard from_mask, BitB
     }
 
     //generate en passant captures
-    if(ep_square && (BB_SQUARES[ep_square] & to_mask) && !(BB_SQUARES[ep_square] & occupied)){
+    if(ep_square != NO_SQUARE && (BB_SQUARES[ep_square] & to_mask) && !(BB_SQUARES[ep_square] & occupied)){
         BitBoard ep_rank = (turn == WHITE) ? BB_RANK_5 : BB_RANK_4;
         BitBoard capturers = pawns & occupied_color[turn] & from_mask &
                              BB_PAWN_ATTACKS[turn ^ 1][ep_square] & ep_rank;
@@ -321,7 +350,14 @@ Move Board::generatePseudoLegalEP() const{
 }
 
 bool Board::isPseudoLegal(const Move& move) const{
-    for(auto pseudo_legal_move: generatePseudoLegalMoves()){
+    if(move.from_square >= 64 || move.to_square >= 64){
+        return false;
+    }
+
+    // castling is generated from the rook square, so only restrict the from square
+    BitBoard to_mask = isCastling(move) ? BB_ALL : BB_SQUARES[move.to_square];
+
+    for(auto pseudo_legal_move: generatePseudoLegalMoves(BB_SQUARES[move.from_square], to_mask)){
         if(pseudo_legal_move == move){
             return true;
         }
@@ -376,6 +412,90 @@ bool Board::isLegal(const Move& move) const{
     return isPseudoLegal(move) && !isIntoCheck(move);
 }
 
+// Static exchange evaluation: material won by the side to move when both
+// sides keep recapturing on the target square with their least valuable
+// attacker. Sliders behind a capturer join in once it has left the line.
+// Pins are ignored. The exchange is cut short once neither side can come
+// out ahead, which keeps the sign exact but not always the amount.
+int Board::see(const Move& move) const{
+    if(isCastling(move)){
+        return 0;
+    }
+
+    Square to = move.to_square;
+    BitBoard occupied_squares = occupied ^ BB_SQUARES[move.from_square];
+    BitBoard last_rank = BB_RANK_1 | BB_RANK_8;
+
+    int gain[32];
+    gain[0] = SEE_VALUES[pieceTypeAt(to)];
+    if(isEnPassant(move)){
+        gain[0] = SEE_VALUES[PAWN];
+        occupied_squares ^= BB_SQUARES[to + (turn == WHITE ? -8 : 8)];
+    }
+
+    // value of the piece now standing on the target square
+    int on_square = SEE_VALUES[pieceTypeAt(move.from_square)];
+    if(move.promotion != NO_PIECE){
+        gain[0] += SEE_VALUES[move.promotion] - SEE_VALUES[PAWN];
+        on_square = SEE_VALUES[move.promotion];
+    }
+
+    BitBoard attackers = (attackersMask(WHITE, to, occupied_squares) | attackersMask(BLACK, to, occupied_squares)) & occupied_squares;
+    Color side = turn ^ 1;
+    int d = 0;
+
+    while(d < 31){
+        BitBoard side_attackers = attackers & occupied_color[side];
+        if(!side_attackers){
+            break;
+        }
+
+        PieceType piecetype = PAWN;
+        BitBoard bb = side_attackers & piecesMask(PAWN, side);
+        while(!bb){
+            piecetype++;
+            bb = side_attackers & piecesMask(piecetype, side);
+        }
+
+        // the king may only take last, onto an undefended square
+        if(piecetype == KING && (attackers & occupied_color[side ^ 1])){
+            break;
+        }
+
+        d++;
+        gain[d] = on_square - gain[d-1];
+        on_square = SEE_VALUES[piecetype];
+
+        if(piecetype == PAWN && (BB_SQUARES[to] & last_rank)){
+            gain[d] += SEE_VALUES[QUEEN] - SEE_VALUES[PAWN];
+            on_square = SEE_VALUES[QUEEN];
+        }
+
+        // neither side can come out ahead by going on
+        if(std::max(-gain[d-1], gain[d]) < 0){
+            break;
+        }
+
+        Square from = lsb(bb);
+        occupied_squares ^= BB_SQUARES[from];
+
+        // only a capturer on a line through the target can uncover a slider
+        if(BB_RAYS[to][from]){
+            attackers = (attackersMask(WHITE, to, occupied_squares) | attackersMask(BLACK, to, occupied_squares));
+        }
+        attackers &= occupied_squares;
+
+        side ^= 1;
+    }
+
+    while(d > 0){
+        gain[d-1] = -std::max(-gain[d-1], gain[d]);
+        d--;
+    }
+
+    return gain[0];
+}
+
 BitBoard Board::checkersMask() const{
     return attackersMask(turn ^ 1, king(turn));
 }
@@ -428,6 +548,17 @@ bool Board::isFiftyMoves() const{
     return isHalfmoves(100);
 }
 
+bool Board::isRepetition(int count) const{
+    // the same side is to move every second ply
+    int seen = 1;
+    for(int back = 2; back <= halfmove_clock && back <= (int)state_stack.size(); back += 2){
+        if(state_stack[state_stack.size() - back].samePosition(*this) && ++seen >= count){
+            return true;
+        }
+    }
+    return seen >= count;
+}
+
 Outcome Board::gameOutcome() const{
     if(isInsufficientMaterial() || isFiftyMoves()){
         return DRAW;
@@ -581,71 +712,212 @@ const std::vector<Move> Board::generateLegalMoves() const{
     return generateLegalMoves(BB_ALL, BB_ALL);
 }
 
-void Board::setBoardFEN(std::string fen){
-    Board::clearBoard();
+// Legal captures, en passant and promotions
+const std::vector<Move> Board::generateLegalCaptures() const{
+    BitBoard targets = occupied_color[turn ^ 1];
+    if(ep_square != NO_SQUARE){
+        targets |= BB_SQUARES[ep_square];
+    }
 
-    std::istringstream iss(fen);
-    std::string s;
+    // other pieces can step onto the empty en passant square, drop those
+    std::vector<Move> moves;
+    for(auto move: generateLegalMoves(BB_ALL, targets)){
+        if(isCapture(move)){
+            moves.push_back(move);
+        }
+    }
 
-    // position 
-    iss >> s;
-    BaseBoard::setBoardFEN(s);
+    BitBoard promotion_rank = (turn == WHITE) ? BB_RANK_8 : BB_RANK_1;
+    for(auto move: generateLegalMoves(pawns & occupied_color[turn], promotion_rank & ~occupied)){
+        moves.push_back(move);
+    }
 
-    // turn
-    iss >> s;
-    if(s == "b"){
-        turn = BLACK;
-    } else {
-        turn = WHITE;
+    return moves;
+}
+
+void Board::setBoardFEN(std::string_view fen){
+    FENError error;
+    if(!parseFEN(fen, *this, error)){
+        throw std::invalid_argument(error.message);
     }
+}
 
-    // castling rights
-    iss >> s;
-    if(s == "-"){
-        castling_rights = BB_EMPTY;
-    } else {
-        for(auto &flag: s){
-            if(flag == 'K'){
-                castling_rights |= BB_RANK_1 & BB_FILE_H;
-            } else if (flag == 'Q'){
-                castling_rights |= BB_RANK_1 & BB_FILE_A;
-            } else if (flag == 'k'){
-                castling_rights |= BB_RANK_8 & BB_FILE_H;
-            } else if (flag == 'q'){
-                castling_rights |= BB_RANK_8 & BB_FILE_A;
-            }
+void Board::pushUCI(std::string_view uci){
+    Move m = Move(uci);
+    if(m != NO_MOVE && isLegal(m)){
+        push(m);
+    }
+}
+
+const char SAN_PIECE_LETTERS[7] = {' ', ' ', 'N', 'B', 'R', 'Q', 'K'};
+
+// Pieces of the side to move, besides the one on from, that can also
+// legally go to the destination of move
+BitBoard Board::sanAmbiguities(const Move& move, PieceType piecetype) const{
+    BitBoard others = attackersMask(turn, move.to_square) & piecesMask(piecetype, turn) & ~BB_SQUARES[move.from_square];
+
+    BitBoard ambiguous = BB_EMPTY;
+    while(others){
+        Square from = lsb(others);
+        if(isLegal(Move(from, move.to_square, move.promotion))){
+            ambiguous |= BB_SQUARES[from];
         }
+        others &= (others - 1);
     }
+    return ambiguous;
+}
 
-    iss >> s;
-    if(s == "-"){
-        ep_square = NO_SQUARE;
+size_t Board::writeSAN(const Move& move, char* buffer){
+    size_t length = 0;
+    PieceType piecetype = pieceTypeAt(move.from_square);
+
+    if(isCastling(move)){
+        const char* castle = squareFile(move.to_square) > squareFile(move.from_square) ? "O-O" : "O-O-O";
+        while(*castle){
+            buffer[length++] = *castle++;
+        }
     } else {
-        int i = 0;
-        while(i < 64){
-            if(s == SQUARE_NAMES[i]){
-                ep_square = i;
-                break;
+        bool capture = isCapture(move);
+
+        if(piecetype == PAWN){
+            if(capture){
+                buffer[length++] = 'a' + squareFile(move.from_square);
             }
-            i++;
+        } else {
+            buffer[length++] = SAN_PIECE_LETTERS[piecetype];
+
+            // the file if that tells the pieces apart, else the rank, else both
+            BitBoard ambiguous = (piecetype == KING) ? BB_EMPTY : sanAmbiguities(move, piecetype);
+            if(ambiguous){
+                BitBoard file_mask = BB_FILE_A << squareFile(move.from_square);
+                BitBoard rank_mask = BB_RANK_1 << (8 * squareRank(move.from_square));
+                if(!(ambiguous & file_mask)){
+                    buffer[length++] = 'a' + squareFile(move.from_square);
+                } else if (!(ambiguous & rank_mask)){
+                    buffer[length++] = '1' + squareRank(move.from_square);
+                } else {
+                    buffer[length++] = 'a' + squareFile(move.from_square);
+                    buffer[length++] = '1' + squareRank(move.from_square);
+                }
+            }
+        }
+
+        if(capture){
+            buffer[length++] = 'x';
+        }
+        buffer[length++] = 'a' + squareFile(move.to_square);
+        buffer[length++] = '1' + squareRank(move.to_square);
+
+        if(move.promotion >= KNIGHT && move.promotion <= QUEEN){
+            buffer[length++] = '=';
+            buffer[length++] = SAN_PIECE_LETTERS[move.promotion];
         }
     }
 
-    // halfmove clock
-    iss >> s;
-    halfmove_clock = std::stoi(s);
+    push(move);
+    if(isCheck()){
+        buffer[length++] = isCheckmate() ? '#' : '+';
+    }
+    pop();
 
-    // fullmove
-    iss >> s;
-    fullmove_number = std::stoi(s);
+    buffer[length] = '\0';
+    return length;
 }
 
-void Board::pushUCI(std::string uci){
-    Move m = Move(uci);
-    if(isLegal(m)){
-        push(m);
+std::string Board::toSAN(const Move& move){
+    char buffer[SAN_MAX_LENGTH];
+    return std::string(buffer, writeSAN(move, buffer));
+}
+
+bool Board::parseSAN(std::string_view san, Move& move) const{
+    while(!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')){
+        san.remove_suffix(1);
+    }
+
+    Square king_square = king(turn);
+    if(san == "O-O" || san == "0-0"){
+        move = Move(king_square, king_square + 2);
+        return isLegal(move);
+    } else if (san == "O-O-O" || san == "0-0-0"){
+        move = Move(king_square, king_square - 2);
+        return isLegal(move);
+    }
+
+    PieceType piecetype = PAWN;
+    if(!san.empty()){
+        const char* letter = (const char*)std::memchr(SAN_PIECE_LETTERS + KNIGHT, san.front(), KING - KNIGHT + 1);
+        if(letter){
+            piecetype = letter - SAN_PIECE_LETTERS;
+            san.remove_prefix(1);
+        }
+    }
+
+    PieceType promotion = NO_PIECE;
+    if(piecetype == PAWN && !san.empty()){
+        const char* letter = (const char*)std::memchr(SAN_PIECE_LETTERS + KNIGHT, san.back(), QUEEN - KNIGHT + 1);
+        if(letter){
+            promotion = letter - SAN_PIECE_LETTERS;
+            san.remove_suffix(1);
+            if(!san.empty() && san.back() == '='){
+                san.remove_suffix(1);
+            }
+        }
+    }
+
+    if(san.size() < 2){
+        return false;
+    }
+    char to_file = san[san.size() - 2], to_rank = san[san.size() - 1];
+    if(to_file < 'a' || to_file > 'h' || to_rank < '1' || to_rank > '8'){
+        return false;
+    }
+    Square to_square = 8 * (to_rank - '1') + (to_file - 'a');
+    san.remove_suffix(2);
+
+    bool capture = !san.empty() && san.back() == 'x';
+    if(capture){
+        san.remove_suffix(1);
+    }
+
+    // what is left is the file and rank of the origin, either may be missing
+    BitBoard from_mask = BB_ALL;
+    for(char c: san){
+        if(c >= 'a' && c <= 'h'){
+            from_mask &= BB_FILE_A << (c - 'a');
+        } else if (c >= '1' && c <= '8'){
+            from_mask &= BB_RANK_1 << (8 * (c - '1'));
+        } else {
+            return false;
+        }
     }
-} 
+
+    BitBoard candidates = piecesMask(piecetype, turn) & from_mask;
+    if(piecetype != PAWN || capture){
+        candidates &= attackersMask(turn, to_square);
+    } else {
+        // pushes come from one or two squares behind on the same file
+        int forward = (turn == WHITE) ? 8 : -8;
+        Square single = to_square - forward;
+        if(single < 64 && (occupied & BB_SQUARES[single])){
+            candidates &= BB_SQUARES[single];
+        } else if (single < 64 && squareRank(to_square) == ((turn == WHITE) ? 3 : 4)){
+            candidates &= BB_SQUARES[(Square)(single - forward)];
+        } else {
+            return false;
+        }
+    }
+
+    int found = 0;
+    while(candidates){
+        Move candidate(lsb(candidates), to_square, promotion);
+        if(isLegal(candidate)){
+            move = candidate;
+            found++;
+        }
+        candidates &= (candidates - 1);
+    }
+    return found == 1;
+}
 
 void Board::print() const{
     BaseBoard::print();
@@ -677,6 +949,10 @@ BoardState::BoardState(Board* board){
     occupied_color[WHITE] = board->occupied_color[WHITE];
     occupied_color[BLACK] = board->occupied_color[BLACK];
 
+    std::copy(&board->mg_score[0][0], &board->mg_score[0][0] + 4, &mg_score[0][0]);
+    std::copy(&board->eg_score[0][0], &board->eg_score[0][0] + 4, &eg_score[0][0]);
+    game_phase = board->game_phase;
+
     turn = board->turn;
     castling_rights = board->castling_rights;
     ep_square = board->ep_square;
@@ -684,6 +960,19 @@ BoardState::BoardState(Board* board){
     halfmove_clock = board->halfmove_clock;
 }
 
+bool BoardState::samePosition(const Board& board) const{
+    return pawns == board.pawns &&
+           knights == board.knights &&
+           bishops == board.bishops &&
+           rooks == board.rooks &&
+           queens == board.queens &&
+           kings == board.kings &&
+           occupied_color[WHITE] == board.occupied_color[WHITE] &&
+           turn == board.turn &&
+           castling_rights == board.castling_rights &&
+           ep_square == board.ep_square;
+}
+
 void BoardState::restore(Board* board){
     board->pawns = pawns;
     board->bishops = bishops;
@@ -696,6 +985,10 @@ void BoardState::restore(Board* board){
     board->occupied_color[WHITE] = occupied_color[WHITE];
     board->occupied_color[BLACK] = occupied_color[BLACK];
 
+    std::copy(&mg_score[0][0], &mg_score[0][0] + 4, &board->mg_score[0][0]);
+    std::copy(&eg_score[0][0], &eg_score[0][0] + 4, &board->eg_score[0][0]);
+    board->game_phase = game_phase;
+
     board->turn = turn;
     board->castling_rights = castling_rights;
     board->ep_square = ep_square;
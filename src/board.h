@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "move.h"
@@ -9,6 +10,9 @@
 
 class Board;
 
+// "Qa1xb2#" or "exd8=Q#" and the '\0'
+const size_t SAN_MAX_LENGTH = 8;
+
 class BoardState{
     // BaseBoard state
     BitBoard pawns, knights, bishops, rooks, queens, kings;
@@ -16,6 +20,10 @@ class BoardState{
     BitBoard occupied;
     BitBoard occupied_color[2];
 
+    int mg_score[2][2];
+    int eg_score[2][2];
+    int game_phase;
+
     // Board state
     Color turn;
     BitBoard castling_rights;
@@ -26,6 +34,8 @@ class BoardState{
         BoardState(Board* board);
         void restore(Board* board);
 
+        bool samePosition(const Board& board) const;
+
 };
 
 class Board: public BaseBoard{
@@ -49,22 +59,27 @@ class Board: public BaseBoard{
 
     bool attackedForKing(BitBoard path, BitBoard occupied) const;
 
+    BitBoard sanAmbiguities(const Move& move, PieceType piecetype) const;
+
     public:
         Color turn;
         BitBoard castling_rights;
         Square ep_square;
         int fullmove_number, halfmove_clock;
 
-        Board(std::string fen);
+        Board(std::string_view fen);
         Board();
 
         void resetBoard();
         void clearBoard();
 
         void push(const Move& move);
+        void pushNull();
         Move pop();
+        Move peek() const;
 
         const std::vector<Move> generateLegalMoves() const;
+        const std::vector<Move> generateLegalCaptures() const;
         const std::vector<Move> generatePseudoLegalMoves() const;
 
         Move generatePseudoLegalEP() const;
@@ -77,6 +92,8 @@ class Board: public BaseBoard{
         bool isCapture(const Move& move) const;
         bool isLegal(const Move& move) const;
 
+        int see(const Move& move) const;
+
 
         BitBoard checkersMask() const;
         bool isCheck() const;
@@ -87,11 +104,28 @@ class Board: public BaseBoard{
         bool isInsufficientMaterial() const;
         bool isFiftyMoves() const;
 
+        // The position occurred count times, this one included, since the
+        // last capture or pawn move of the pushed moves
+        bool isRepetition(int count = 3) const;
+
         Outcome gameOutcome() const;
 
-        void setBoardFEN(std::string fen);
+        // Throws std::invalid_argument naming the problem for an invalid
+        // FEN, see parseFEN for the checks and writeFEN for the reverse
+        void setBoardFEN(std::string_view fen);
+
+        void pushUCI(std::string_view uci);
+
+        // Standard algebraic notation of a legal move, disambiguated and
+        // with a + or # suffix, written like Move::writeUCI into
+        // SAN_MAX_LENGTH chars. Pushes and pops the move for the suffix.
+        size_t writeSAN(const Move& move, char* buffer);
+        std::string toSAN(const Move& move);
 
-        void pushUCI(std::string uci);
+        // Finds the move from the squares attacking the destination, false
+        // unless san names exactly one legal move. Accepts "0-0" castling,
+        // promotions without '=' and trailing +, #, ! and ? marks.
+        bool parseSAN(std::string_view san, Move& move) const;
 
         void print() const;
 
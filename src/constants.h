@@ -18,6 +18,10 @@ const PieceType ROOK = 4;
 const PieceType QUEEN = 5;
 const PieceType KING = 6;
 
+// Material used by static exchange evaluation. The king never gets
+// captured in an exchange, so it is worth nothing there.
+const int SEE_VALUES[7] = {0, 100, 325, 325, 500, 975, 0};
+
 typedef uint8_t Square;
 
 const Square NO_SQUARE = -1;
@@ -1,58 +1,52 @@
 #include "engine.h"
 #include "board.h"
-#include "positiontables.h"
-
+#include "tt.h"
+#include "ordering.h"
+#include "threadpool.h"
+#include "stats.h"
+#include "nnue.h"
+#include "evalcache.h"
+#include "syzygy.h"
+#include "bitbase.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <functional>
+#include <iostream>
 #include <random>
-#include <unordered_map>
 
 #ifndef INT_MIN
 #define INT_MIN -2147483648
 #define INT_MAX 2147483647
 #endif
 
-inline int dotProduct(BitBoard bb, const int16_t weights[]){
-    int accu = 0;
-    while(bb){
-        accu += weights[lsb(bb)];
-        bb &= (bb - 1);
-    }
-    return accu;
-}
-
-inline int dotProductReverse(BitBoard bb, const int16_t weights[]){
-    int accu = 0;
-    while(bb){
-        accu += weights[63-lsb(bb)];
-        bb &= (bb - 1);
-    }
-    return accu;
-}
-
-BitBoard randBitBoard(){
-    std::random_device engine;
-    BitBoard random_bb = engine() | (BitBoard)engine()<<32;
-
-    return random_bb;
+BitBoard randBitBoard(std::mt19937_64& engine){
+    return engine();
 }
 
 void initZobrist(ZobristTable& table){
+    std::mt19937_64 engine(ZOBRIST_SEED);
+
     for(int i = 0; i < 64; i++){
         for(int j = 0; j < 6; j++){
-            table.pieces[i][j][WHITE] = randBitBoard();
-            table.pieces[i][j][BLACK] = randBitBoard();
+            table.pieces[i][j][WHITE] = randBitBoard(engine);
+            table.pieces[i][j][BLACK] = randBitBoard(engine);
         }
     }
 
     for(int i = 0; i < 8; i++){
-        table.ep_files[i] = randBitBoard();
+        table.ep_files[i] = randBitBoard(engine);
     }
 
     for(int i = 0; i < 4; i++){
-        table.castling_rights[i] = randBitBoard();
+        table.castling_rights[i] = randBitBoard(engine);
     }
 
-    table.black_to_move = randBitBoard();
+    table.black_to_move = randBitBoard(engine);
+    table.seed = ZOBRIST_SEED;
 }
 
 uint64_t hashZobrist(const Board& b, const ZobristTable& table){
@@ -212,128 +206,471 @@ uint64_t updateZobrist(uint64_t hash, const Board& board, const Move& move, cons
     return hash;
 }
 
-// optimize for current color
-int evaluation(const Board& b){
-    int mg_value = 0;
-    int eg_value = 0;
-    int game_phase = 0;
+// update zobrist hash BEFORE a null move is pushed to board
+uint64_t updateZobristNull(uint64_t hash, const Board& board, const ZobristTable& table){
+    if(board.ep_square != NO_SQUARE){
+        hash ^= table.ep_files[squareFile(board.ep_square)];
+    }
+
+    return hash ^ table.black_to_move;
+}
+
+// added to the evaluation of won king and pawn versus king positions, more
+// the further the pawn has advanced so the search keeps pushing it
+const int KPK_WIN_BONUS = 400;
+const int KPK_RANK_BONUS = 20;
 
+// Tapered material and piece-square score kept up to date by the board. The
+// side to move reads the tables from h8, the other side from a1.
+int evaluation(const Board& b){
     Color turn = b.turn;
 
-    // material values
+    int mg_value = b.mg_score[turn][1] - b.mg_score[turn ^ 1][0];
+    int eg_value = b.eg_score[turn][1] - b.eg_score[turn ^ 1][0];
 
-    // pawns
-    mg_value += popcount(b.pawns & b.occupied_color[turn]) * 82;
-    mg_value -= popcount(b.pawns & b.occupied_color[turn ^ 1]) * 82;
+    int mg_phase = b.game_phase;
+    if (mg_phase > 24) mg_phase = 24;
 
-    eg_value += popcount(b.pawns & b.occupied_color[turn]) * 94;
-    eg_value -= popcount(b.pawns & b.occupied_color[turn ^ 1]) * 94;
+    int eg_phase = 24 - mg_phase;
+    return (mg_value * mg_phase + eg_value * eg_phase) / 24;
+}
 
-    // knights
-    mg_value += popcount(b.knights & b.occupied_color[turn]) * 337;
-    mg_value -= popcount(b.knights & b.occupied_color[turn ^ 1]) * 337;
+// Known king and pawn versus king endings: draws score 0, wins keep the
+// evaluation plus a bonus that still leaves promoting the better choice
+bool isKPK(const Board& b){
+    return b.pawns && !(b.pawns & (b.pawns - 1)) && (b.occupied ^ b.kings) == b.pawns;
+}
 
-    eg_value += popcount(b.knights & b.occupied_color[turn]) * 281;
-    eg_value -= popcount(b.knights & b.occupied_color[turn ^ 1]) * 281;
+int staticEvaluation(const Board& b, const SearchOptions& options){
+    if(isKPK(b)){
+        if(!probeKPK(b)){
+            return 0;
+        }
+        Square pawn = lsb(b.pawns);
+        Color strong = b.colorAt(pawn);
+        int bonus = KPK_WIN_BONUS + KPK_RANK_BONUS * (strong == WHITE ? squareRank(pawn) : 7 - squareRank(pawn));
 
-    game_phase += popcount(b.knights);
+        int score = (options.use_nnue && networkLoaded()) ? evaluateNNUE(b) : evaluation(b);
+        return std::clamp(score + (strong == b.turn ? bonus : -bonus), -MATE_SCORE / 2, MATE_SCORE / 2);
+    }
 
-    // bishops
-    mg_value += popcount(b.bishops & b.occupied_color[turn]) * 365;
-    mg_value -= popcount(b.bishops & b.occupied_color[turn ^ 1]) * 365;
+    if(options.use_nnue && networkLoaded()){
+        return std::clamp(evaluateNNUE(b), -MATE_SCORE / 2, MATE_SCORE / 2);
+    }
+    return evaluation(b);
+}
 
-    eg_value += popcount(b.bishops & b.occupied_color[turn]) * 297;
-    eg_value -= popcount(b.bishops & b.occupied_color[turn ^ 1]) * 297;
+// nodes searched between checks of the clock
+const int CHECK_INTERVAL = 2048;
 
-    game_phase += popcount(b.bishops);
+// margin on top of the captured piece before a capture is delta pruned
+const int DELTA_MARGIN = 200;
 
-    // rooks 
-    mg_value += popcount(b.rooks & b.occupied_color[turn]) * 477;
-    mg_value -= popcount(b.rooks & b.occupied_color[turn ^ 1]) * 477;
+// aspiration windows start this wide around the last score and fall back
+// to a full window once widening goes past ASPIRATION_MAX
+const int ASPIRATION_DEPTH = 4;
+const int ASPIRATION_WINDOW = 25;
+const int ASPIRATION_MAX = 1000;
 
-    eg_value += popcount(b.rooks & b.occupied_color[turn]) * 512;
-    eg_value -= popcount(b.rooks & b.occupied_color[turn ^ 1]) * 512;
+const int PIECE_VALUES[7] = {0, 82, 337, 365, 477, 1025, 0};
 
-    game_phase += popcount(b.rooks) * 2;
+// null move searches are at least this much shallower, more at high depth
+const int NULL_MOVE_REDUCTION = 2;
 
-    // queens
-    mg_value += popcount(b.queens & b.occupied_color[turn]) * 1025;
-    mg_value -= popcount(b.queens & b.occupied_color[turn ^ 1]) * 1025;
+// tablebase wins score below every mate the search can find
+const int TB_WIN_SCORE = MATE_SCORE - 2 * MAX_PLY;
 
-    eg_value += popcount(b.queens & b.occupied_color[turn]) * 936;
-    eg_value -= popcount(b.queens & b.occupied_color[turn ^ 1]) * 936;
+// Mate and tablebase scores count plies from the root of the search that
+// found them; the table keeps them counted from the stored node instead, so
+// they stay right at another ply, in a later search or from a dump
+int valueToTT(int value, int ply){
+    if(value >= TB_WIN_SCORE - MAX_PLY){
+        return value + ply;
+    }
+    if(value <= -TB_WIN_SCORE + MAX_PLY){
+        return value - ply;
+    }
+    return value;
+}
 
-    game_phase += popcount(b.queens) * 4;
+// Wins and losses from the tables as scores at ply, cursed wins and blessed
+// losses as the small values they are
+int tbValue(int wdl, int ply){
+    return (wdl < TB_BLESSED_LOSS) ? -TB_WIN_SCORE + ply : (wdl > TB_CURSED_WIN) ? TB_WIN_SCORE - ply : wdl;
+}
 
-    // piece-position tables
+int valueFromTT(int value, int ply){
+    if(value >= TB_WIN_SCORE - MAX_PLY){
+        return value - ply;
+    }
+    if(value <= -TB_WIN_SCORE + MAX_PLY){
+        return value + ply;
+    }
+    return value;
+}
 
-    // pawns
-    mg_value += dotProductReverse(b.pawns & b.occupied_color[turn], mg_pawn_table);
-    mg_value -= dotProduct(b.pawns & b.occupied_color[turn ^ 1], mg_pawn_table);
+SearchOptions search_options;
 
-    eg_value += dotProductReverse(b.pawns & b.occupied_color[turn], eg_pawn_table);
-    eg_value -= dotProduct(b.pawns & b.occupied_color[turn ^ 1], eg_pawn_table);
+// Late move reductions grow with the log of both depth and move number
+struct ReductionTable{
+    int reductions[MAX_DEPTH+1][64];
 
-    // knights
-    mg_value += dotProductReverse(b.knights & b.occupied_color[turn], mg_knight_table);
-    mg_value -= dotProduct(b.knights & b.occupied_color[turn ^ 1], mg_knight_table);
+    ReductionTable(){
+        for(int depth = 0; depth <= MAX_DEPTH; depth++){
+            for(int moves = 0; moves < 64; moves++){
+                if(depth == 0 || moves == 0){
+                    reductions[depth][moves] = 0;
+                } else {
+                    reductions[depth][moves] = (int)(0.75 + std::log(depth) * std::log(moves) / 2.25);
+                }
+            }
+        }
+    }
+};
 
-    eg_value += dotProductReverse(b.knights & b.occupied_color[turn], eg_knight_table);
-    eg_value -= dotProduct(b.knights & b.occupied_color[turn ^ 1], eg_knight_table);
+const ReductionTable LMR_TABLE;
+
+struct SearchState{
+    const ZobristTable& z_table;
+    TranspositionTable& transposition_table;
+
+    std::chrono::steady_clock::time_point start;
+    int hard_ms;
+
+    // the time limits run from here: the start, or the ponderhit of a
+    // ponder search, when the opponent's clock stops and ours starts
+    std::chrono::steady_clock::time_point budget_start;
+
+    // counters of this thread, main search and quiescence nodes apart
+    ThreadStats& stats;
+    bool stopped;
+
+    // node budget of the whole search, checked by the main thread against
+    // the counters of every thread; 0 for no limit
+    uint64_t node_limit;
+    const std::vector<ThreadStats>* all_stats;
+
+    // raised by another thread to end this search
+    const std::atomic<bool>* shared_stop;
+
+    // external stop and ponderhit, time limits are ignored while pondering
+    const SearchSignals* signals;
+    bool pondering;
+
+    SearchOptions options;
+    OrderingTables ordering;
+    EvalCache eval_cache;
+
+    // root moves left after tablebase filtering, empty to search them all
+    std::vector<Move> root_moves;
+
+    // triangular PV table, row ply holds the best line found from that ply
+    Move pv[MAX_PLY+1][MAX_PLY+1];
+    int pv_length[MAX_PLY+1];
+
+    SearchState(const ZobristTable& z_table, TranspositionTable& transposition_table, int hard_ms, ThreadStats& stats)
+        : z_table(z_table), transposition_table(transposition_table), hard_ms(hard_ms), stats(stats){
+        start = std::chrono::steady_clock::now();
+        budget_start = start;
+        stopped = false;
+        node_limit = 0;
+        all_stats = nullptr;
+        shared_stop = nullptr;
+        signals = nullptr;
+        pondering = false;
+        pv_length[0] = 0;
+        options = search_options;
+        eval_cache.resize(std::max(0, options.eval_cache_kb));
+    }
+};
 
-    // bishops
-    mg_value += dotProductReverse(b.bishops & b.occupied_color[turn], mg_bishop_table);
-    mg_value -= dotProduct(b.bishops & b.occupied_color[turn ^ 1], mg_bishop_table);
+int elapsedMs(const SearchState& state){
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - state.start).count();
+}
 
-    eg_value += dotProductReverse(b.bishops & b.occupied_color[turn], eg_bishop_table);
-    eg_value -= dotProduct(b.bishops & b.occupied_color[turn ^ 1], eg_bishop_table);
-    
-    // rooks
-    mg_value += dotProductReverse(b.rooks & b.occupied_color[turn], mg_rook_table);
-    mg_value -= dotProduct(b.rooks & b.occupied_color[turn ^ 1], mg_rook_table);
+int budgetElapsedMs(const SearchState& state){
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - state.budget_start).count();
+}
 
-    eg_value += dotProductReverse(b.rooks & b.occupied_color[turn], eg_rook_table);
-    eg_value -= dotProduct(b.rooks & b.occupied_color[turn ^ 1], eg_rook_table);
+void checkSignals(SearchState& state){
+    if(state.shared_stop && state.shared_stop->load(std::memory_order_relaxed)){
+        state.stopped = true;
+    }
 
-    // queens
-    mg_value += dotProductReverse(b.queens & b.occupied_color[turn], mg_queen_table);
-    mg_value -= dotProduct(b.queens & b.occupied_color[turn ^ 1], mg_queen_table);
+    if(state.signals){
+        if(state.signals->stop.load(std::memory_order_relaxed)){
+            state.stopped = true;
+        }
+        if(state.pondering && state.signals->ponderhit.load(std::memory_order_relaxed)){
+            state.pondering = false;
+            state.budget_start = std::chrono::steady_clock::now();
+        }
+    }
+}
 
-    eg_value += dotProductReverse(b.queens & b.occupied_color[turn], eg_queen_table);
-    eg_value -= dotProduct(b.queens & b.occupied_color[turn ^ 1], eg_queen_table);
+uint64_t searchedNodes(const SearchState& state){
+    if(!state.all_stats){
+        return state.stats.counters[STAT_NODES].load(std::memory_order_relaxed) +
+               state.stats.counters[STAT_QNODES].load(std::memory_order_relaxed);
+    }
 
-    // kings
-    mg_value += dotProductReverse(b.kings & b.occupied_color[turn], mg_king_table);
-    mg_value -= dotProduct(b.kings & b.occupied_color[turn ^ 1], mg_king_table);
+    uint64_t nodes = 0;
+    for(auto& stats: *state.all_stats){
+        nodes += stats.counters[STAT_NODES].load(std::memory_order_relaxed) +
+                 stats.counters[STAT_QNODES].load(std::memory_order_relaxed);
+    }
+    return nodes;
+}
 
-    eg_value += dotProductReverse(b.kings & b.occupied_color[turn], eg_king_table);
-    eg_value -= dotProduct(b.kings & b.occupied_color[turn ^ 1], eg_king_table);
+// Called every CHECK_INTERVAL nodes, so a search overshoots its limits by
+// at most that many nodes per thread
+void checkTime(SearchState& state){
+    checkSignals(state);
 
-    int mg_phase = game_phase;
-    if (mg_phase > 24) mg_phase = 24;
+    // time spent pondering is on the opponent's clock, the budget starts
+    // with the ponderhit
+    if(!state.pondering && state.hard_ms >= 0 && budgetElapsedMs(state) >= state.hard_ms){
+        state.stopped = true;
+    }
 
-    int eg_phase = 24 - mg_phase;
-    return (mg_value * mg_phase + eg_value * eg_phase) / 24;
+    if(!state.pondering && state.node_limit > 0 && searchedNodes(state) >= state.node_limit){
+        state.stopped = true;
+    }
+}
+
+// one eval cache probe in EVAL_TIMING_INTERVAL is timed to estimate what
+// the cache saves
+const int EVAL_TIMING_INTERVAL = 256;
+
+// Cost of reading the clock, taken off every timed interval
+int64_t clockOverheadNs(){
+    static const int64_t overhead = []{
+        const int samples = 1000;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < samples; i++){
+            std::chrono::steady_clock::now();
+        }
+        auto end = std::chrono::steady_clock::now();
+        return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / samples;
+    }();
+    return overhead;
 }
 
-const uint8_t LOWER_BOUND = 0;
-const uint8_t EXACT = 1;
-const uint8_t UPPER_BOUND = 2;
+// Short intervals can come out below zero. Not clamped, so the means stay
+// unbiased; the unsigned counters wrap and their sums remain exact.
+int64_t elapsedNs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to){
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    return ns - clockOverheadNs();
+}
 
-struct TTEntry {
-    int value;
-    uint8_t flag;
-    uint8_t depth;
-};
+// A cached evaluation with the cache overhead and, on a miss, the
+// evaluation itself timed apart
+int timedEvaluation(const Board& b, SearchState& state, const uint64_t hash){
+    auto probe_start = std::chrono::steady_clock::now();
+    int score;
+    bool hit = state.eval_cache.probe(hash, score);
+    auto probe_end = std::chrono::steady_clock::now();
+
+    statIncrement(state.stats, STAT_EVAL_TIMED_PROBES);
+    if(hit){
+        statIncrement(state.stats, STAT_EVAL_HITS);
+        statAdd(state.stats, STAT_EVAL_PROBE_NS, elapsedNs(probe_start, probe_end));
+        return score;
+    }
+
+    score = staticEvaluation(b, state.options);
+    auto eval_end = std::chrono::steady_clock::now();
+    state.eval_cache.store(hash, score);
+    auto store_end = std::chrono::steady_clock::now();
 
-int negamax(Board& b, int depth, int alpha, int beta, std::unordered_map<uint64_t, TTEntry>& transposition_table, const ZobristTable& z_table, const uint64_t prev_hash){
+    statAdd(state.stats, STAT_EVAL_PROBE_NS, elapsedNs(probe_start, probe_end) + elapsedNs(eval_end, store_end));
+    statIncrement(state.stats, STAT_EVAL_TIMED_MISSES);
+    statAdd(state.stats, STAT_EVAL_MISS_NS, elapsedNs(probe_end, eval_end));
+    return score;
+}
+
+// Static evaluation through the thread's eval cache, hash is the Zobrist
+// key of b
+int cachedEvaluation(const Board& b, SearchState& state, const uint64_t hash){
+    if(!state.eval_cache.enabled()){
+        return staticEvaluation(b, state.options);
+    }
+
+#ifdef SEARCH_STATS
+    if(statIncrement(state.stats, STAT_EVAL_PROBES) % EVAL_TIMING_INTERVAL == 0){
+        return timedEvaluation(b, state, hash);
+    }
+#endif
+
+    int score;
+    if(state.eval_cache.probe(hash, score)){
+        STAT_INC(state.stats, STAT_EVAL_HITS);
+        return score;
+    }
+
+    score = staticEvaluation(b, state.options);
+    state.eval_cache.store(hash, score);
+    return score;
+}
+
+// Captures and promotions only, so the static evaluation is never taken in
+// the middle of an exchange. hash is only kept up to date while the eval
+// cache is on.
+int quiescence(Board& b, int ply, int alpha, int beta, SearchState& state, const uint64_t hash){
+    state.pv_length[ply] = 0;
+
+    statMax(state.stats.seldepth, ply);
+
+    if(statIncrement(state.stats, STAT_QNODES) % CHECK_INTERVAL == 0){
+        checkTime(state);
+    }
+    if(state.stopped){
+        return 0;
+    }
+
+    if(b.isInsufficientMaterial()){
+        return 0;
+    }
+
+    // in check every evasion is searched and standing pat is not an option
+    bool in_check = b.isCheck();
+
+    int stand_pat = cachedEvaluation(b, state, hash);
+    if(ply >= MAX_PLY - 1){
+        return stand_pat;
+    }
+
+    int value = INT_MIN + 1;
+    if(!in_check){
+        if(stand_pat >= beta){
+            return stand_pat;
+        }
+
+        // even winning a queen would not reach alpha
+        if(stand_pat + PIECE_VALUES[QUEEN] + DELTA_MARGIN < alpha){
+            return stand_pat;
+        }
+
+        value = stand_pat;
+        alpha = std::max(alpha, stand_pat);
+    }
+
+    std::vector<Move> moves = in_check ? b.generateLegalMoves() : b.generateLegalCaptures();
+
+    if(moves.empty()){
+        return in_check ? -MATE_SCORE + ply : stand_pat;
+    }
+
+    std::vector<int> scores;
+    scoreMoves(b, moves, state.ordering, ply, scores);
+
+    for(int i = 0; i < moves.size(); i++){
+        pickMove(moves, scores, i);
+        Move move = moves.at(i);
+
+        // captures that lose material by static exchange are ordered last
+        // and not searched
+        if(!in_check && state.options.see_pruning && scores.at(i) < CAPTURE_SCORE){
+            break;
+        }
+
+        // delta pruning: skip captures that cannot lift the score to alpha
+        if(!in_check && move.promotion == NO_PIECE){
+            PieceType victim = b.isEnPassant(move) ? PAWN : b.pieceTypeAt(move.to_square);
+            if(stand_pat + PIECE_VALUES[victim] + DELTA_MARGIN <= alpha){
+                continue;
+            }
+        }
+
+        uint64_t child_hash = state.eval_cache.enabled() ? updateZobrist(hash, b, move, state.z_table) : 0;
+        b.push(move);
+        int score = -quiescence(b, ply+1, -beta, -alpha, state, child_hash);
+        b.pop();
+
+        if(state.stopped){
+            return 0;
+        }
+
+        value = std::max(value, score);
+        alpha = std::max(alpha, value);
+        if(alpha >= beta){
+            break;
+        }
+    }
+
+    return value;
+}
+
+void updatePV(SearchState& state, int ply, const Move& move){
+    state.pv[ply][0] = move;
+    for(int i = 0; i < state.pv_length[ply+1]; i++){
+        state.pv[ply][i+1] = state.pv[ply+1][i];
+    }
+    state.pv_length[ply] = state.pv_length[ply+1] + 1;
+}
+
+int negamax(Board& b, int depth, int ply, int alpha, int beta, SearchState& state, const uint64_t prev_hash);
+
+// Search one child of the current node. Only the first move gets the full
+// window; the rest are tried with a null window, at reduced depth if given
+// a reduction, and searched again in full only when they beat alpha.
+int searchChild(Board& b, const Move& move, int depth, int ply, int alpha, int beta, bool first, int reduction, SearchState& state, const uint64_t prev_hash){
+    uint64_t hash = updateZobrist(prev_hash, b, move, state.z_table);
+    state.transposition_table.prefetch(hash);
+
+    b.push(move);
+
+    // checking moves are never reduced
+    if(reduction > 0 && b.isCheck()){
+        reduction = 0;
+    }
+
+    int score;
+    if(first){
+        score = -negamax(b, depth-1, ply+1, -beta, -alpha, state, hash);
+    } else {
+        score = -negamax(b, depth-1-reduction, ply+1, -alpha-1, -alpha, state, hash);
+        if(reduction > 0 && score > alpha){
+            score = -negamax(b, depth-1, ply+1, -alpha-1, -alpha, state, hash);
+        }
+        if(score > alpha && score < beta){
+            score = -negamax(b, depth-1, ply+1, -beta, -alpha, state, hash);
+        }
+    }
+
+    b.pop();
+
+    return score;
+}
+
+int negamax(Board& b, int depth, int ply, int alpha, int beta, SearchState& state, const uint64_t prev_hash){
+    state.pv_length[ply] = 0;
+
+    statMax(state.stats.seldepth, ply);
+
+    if(statIncrement(state.stats, STAT_NODES) % CHECK_INTERVAL == 0){
+        checkTime(state);
+    }
+    if(state.stopped){
+        return 0;
+    }
+
+    bool pv_node = beta - alpha > 1;
     int alpha_orig = alpha;
 
-    auto tt_iter = transposition_table.find(prev_hash);
-    if(tt_iter != transposition_table.end()){
-        TTEntry t = tt_iter->second;
-        if(t.depth >= depth){
+    Move hash_move = NO_MOVE;
+
+    // bounds from the table are only trusted outside the PV, so the PV stays complete
+    TTEntry t;
+    STAT_INC(state.stats, STAT_TT_PROBES);
+    if(state.transposition_table.probe(prev_hash, t)){
+        STAT_INC(state.stats, STAT_TT_HITS);
+        hash_move = t.move;
+        t.value = valueFromTT(t.value, ply);
+
+        if(!pv_node && t.depth >= depth){
             if(t.flag == EXACT){
+                STAT_INC(state.stats, STAT_TT_CUTOFFS);
                 return t.value;
             } else if (t.flag == LOWER_BOUND){
                 alpha = std::max(alpha, t.value);
@@ -342,6 +679,7 @@ int negamax(Board& b, int depth, int alpha, int beta, std::unordered_map<uint64_
             }
             
             if(alpha >= beta){
+                STAT_INC(state.stats, STAT_TT_CUTOFFS);
                 return t.value;
             }
         }
@@ -352,37 +690,159 @@ int negamax(Board& b, int depth, int alpha, int beta, std::unordered_map<uint64_
     }
     
     if(depth == 0){
-        return evaluation(b);
+        return quiescence(b, ply, alpha, beta, state, prev_hash);
     }
 
-    std::vector<Move> moves = b.generateLegalMoves();
+    // Tablebase cutoff, right after a capture or pawn move so the fifty
+    // move counter the tables assume is not already running
+    if(tablebaseLargest() && b.halfmove_clock == 0 && !b.castling_rights){
+        int pieces = popcount(b.occupied);
+        int limit = std::min(state.options.tb_probe_limit, tablebaseLargest());
+
+        int wdl;
+        if((pieces < limit || (pieces == limit && depth >= state.options.tb_probe_depth)) && probeWDL(b, wdl)){
+            statIncrement(state.stats, STAT_TB_HITS);
+
+            int tb_value = tbValue(wdl, ply);
+            int flag = (wdl < TB_BLESSED_LOSS) ? UPPER_BOUND : (wdl > TB_CURSED_WIN) ? LOWER_BOUND : EXACT;
+
+            if(flag == EXACT || (flag == LOWER_BOUND && tb_value >= beta) || (flag == UPPER_BOUND && tb_value <= alpha)){
+                TTEntry tte;
+                tte.value = valueToTT(tb_value, ply);
+                tte.flag = flag;
+                tte.depth = std::min(MAX_DEPTH, depth + 6);
+                tte.move = NO_MOVE;
+
+                STAT_INC(state.stats, STAT_TT_STORES);
+                if(state.transposition_table.store(prev_hash, tte)){
+                    STAT_INC(state.stats, STAT_TT_COLLISIONS);
+                }
+                return tb_value;
+            }
+        }
+    }
 
-    if(moves.empty()){
-        if(b.isCheck()){
-            return (b.turn == WHITE) ? 30000+depth : -30000-depth;
+    bool in_check = b.isCheck();
+
+    // Null move pruning: if passing still fails high the position is good
+    // enough to cut. Skipped in check, right after another null move and
+    // when only pawns are left, where zugzwang makes passing look too good.
+    if(state.options.null_move && !pv_node && !in_check && depth >= state.options.null_move_min_depth &&
+       b.peek() != NULL_MOVE && (b.occupied_color[b.turn] & ~(b.pawns | b.kings)) && cachedEvaluation(b, state, prev_hash) >= beta){
+        int reduction = NULL_MOVE_REDUCTION + depth / 4;
+        uint64_t hash = updateZobristNull(prev_hash, b, state.z_table);
+
+        b.pushNull();
+        int score = -negamax(b, std::max(0, depth-1-reduction), ply+1, -beta, -beta+1, state, hash);
+        b.pop();
+
+        if(state.stopped){
+            return 0;
+        }
+
+        if(score >= beta){
+            // a mate found after passing is not a proven mate
+            return (score >= MATE_SCORE - MAX_PLY) ? beta : score;
         }
-        return 0;
     }
 
     int value = INT_MIN + 1;
+    Move best_move = NO_MOVE;
+    int moves_searched = 0;
+
+    // search the hash move first, a cutoff here skips move generation entirely
+    if(hash_move != NO_MOVE && b.isLegal(hash_move)){
+        value = searchChild(b, hash_move, depth, ply, alpha, beta, true, 0, state, prev_hash);
+        moves_searched++;
+
+        best_move = hash_move;
+        if(value > alpha){
+            alpha = value;
+            updatePV(state, ply, hash_move);
+        }
 
-    for(int i = 0; i < moves.size(); i++){
-        uint64_t hash = updateZobrist(prev_hash, b, moves.at(i), z_table);
+        if(alpha >= beta && !state.stopped){
+            STAT_INC(state.stats, STAT_BETA_CUTOFFS);
+            STAT_CUTOFF(state.stats, 0);
+            updateOrdering(state.ordering, b, hash_move, std::vector<Move>(), depth, ply);
+        }
+    } else {
+        hash_move = NO_MOVE;
+    }
 
-        b.push(moves.at(i));
+    if(alpha < beta && !state.stopped){
+        std::vector<Move> moves = b.generateLegalMoves();
 
-        value = std::max(value, -negamax(b, depth-1, -beta, -alpha, transposition_table, z_table, hash));
-        alpha = std::max(alpha, value);
-        if(alpha >= beta){
-            b.pop();
-            break;
+        if(moves.empty()){
+            if(b.isCheck()){
+                return -MATE_SCORE + ply;
+            }
+            return 0;
+        }
+
+        std::vector<int> scores;
+        scoreMoves(b, moves, state.ordering, ply, scores);
+
+        std::vector<Move> quiets_tried;
+
+        for(int i = 0; i < moves.size(); i++){
+            pickMove(moves, scores, i);
+
+            if(moves.at(i) == hash_move){
+                continue;
+            }
+
+            bool quiet = !b.isCapture(moves.at(i)) && moves.at(i).promotion == NO_PIECE;
+
+            // late quiet moves are searched shallower first
+            int reduction = 0;
+            if(state.options.late_move_reductions && quiet && !in_check && depth >= state.options.lmr_min_depth &&
+               moves_searched >= state.options.lmr_min_moves &&
+               moves.at(i) != state.ordering.killers[ply][0] && moves.at(i) != state.ordering.killers[ply][1]){
+                reduction = LMR_TABLE.reductions[std::min(depth, MAX_DEPTH)][std::min(moves_searched, 63)];
+                if(pv_node){
+                    reduction--;
+                }
+                reduction = std::max(0, std::min(reduction, depth - 2));
+            }
+
+            int score = searchChild(b, moves.at(i), depth, ply, alpha, beta, moves_searched == 0, reduction, state, prev_hash);
+            moves_searched++;
+
+            if(state.stopped){
+                break;
+            }
+
+            if(score > value){
+                value = score;
+                best_move = moves.at(i);
+            }
+
+            if(value > alpha){
+                alpha = value;
+                updatePV(state, ply, moves.at(i));
+            }
+
+            if(alpha >= beta){
+                STAT_INC(state.stats, STAT_BETA_CUTOFFS);
+                STAT_CUTOFF(state.stats, moves_searched - 1);
+                updateOrdering(state.ordering, b, moves.at(i), quiets_tried, depth, ply);
+                break;
+            }
+
+            if(quiet){
+                quiets_tried.push_back(moves.at(i));
+            }
         }
-        
-        b.pop();
+    }
+
+    // the result of an interrupted search is incomplete, don't keep it
+    if(state.stopped){
+        return 0;
     }
 
     TTEntry tte;
-    tte.value = value;
+    tte.value = valueToTT(value, ply);
     if(value <= alpha_orig){
         tte.flag = UPPER_BOUND;
     } else if (value >= beta){
@@ -392,45 +852,349 @@ int negamax(Board& b, int depth, int alpha, int beta, std::unordered_map<uint64_
     }
     tte.depth = depth;
 
-    transposition_table[prev_hash] = tte;
+    // a fail-low has no meaningful best move, keep the old hash move instead
+    tte.move = (value > alpha_orig) ? best_move : hash_move;
+
+    STAT_INC(state.stats, STAT_TT_STORES);
+    if(state.transposition_table.store(prev_hash, tte)){
+        STAT_INC(state.stats, STAT_TT_COLLISIONS);
+    }
  
     return value;
 }
 
-std::pair<int, Move> searchRoot(Board& b, int depth, const ZobristTable& z_table){
-    std::vector<Move> moves = b.generateLegalMoves();
+// One iteration at the root inside the window (alpha, beta). A score at or
+// below alpha or at or above beta is only a bound, and the result is only
+// valid if the search was not stopped.
+std::pair<int, Move> searchDepth(Board& b, int depth, int alpha, int beta, SearchState& state){
+    state.pv_length[0] = 0;
+
+    std::vector<Move> moves = state.root_moves.empty() ? b.generateLegalMoves() : state.root_moves;
 
     if(moves.empty()){
         return std::pair<int, Move>(0, NO_MOVE);
     }
 
-    int alpha = INT_MIN+1;
-    int beta = INT_MAX-1;
+    int alpha_orig = alpha;
+    int value = INT_MIN + 1;
+    int best = 0;
 
-    std::unordered_map<uint64_t, TTEntry> transposition_table;
+    uint64_t prev_hash = hashZobrist(b, state.z_table);
 
-    int best;
+    std::vector<int> scores;
+    scoreMoves(b, moves, state.ordering, 0, scores);
 
-    uint64_t prev_hash = hashZobrist(b, z_table);
+    // the hash move from an earlier iteration goes first
+    TTEntry t;
+    if(state.transposition_table.probe(prev_hash, t)){
+        for(int i = 0; i < moves.size(); i++){
+            if(moves.at(i) == t.move){
+                scores.at(i) = INT_MAX;
+                break;
+            }
+        }
+    }
 
     for(int i = 0; i < moves.size(); i++){
-        uint64_t hash = updateZobrist(prev_hash, b, moves.at(i), z_table);
+        pickMove(moves, scores, i);
 
-        b.push(moves.at(i));
+        int score = searchChild(b, moves.at(i), depth, 0, alpha, beta, i == 0, 0, state, prev_hash);
 
-        int score = -negamax(b, depth-1, -beta, -alpha, transposition_table, z_table, hash);
+        if(state.stopped){
+            break;
+        }
 
-        if(score >= beta){
-            return std::pair<int, Move>(beta, moves.at(i));
+        if(score > value){
+            value = score;
+            if(score > alpha){
+                best = i;
+            }
         }
 
-        if(score > alpha){
-            alpha = score;
-            best = i;
+        if(value > alpha){
+            alpha = value;
+            updatePV(state, 0, moves.at(i));
+        }
+
+        if(alpha >= beta){
+            break;
+        }
+    }
+
+    // an aborted iteration still has the moves that beat alpha before the stop
+    if(state.stopped){
+        if(value > alpha_orig){
+            return std::pair<int, Move>(value, moves.at(best));
+        }
+        return std::pair<int, Move>(0, NO_MOVE);
+    }
+
+    TTEntry tte;
+    tte.value = valueToTT(value, 0);
+    if(value <= alpha_orig){
+        tte.flag = UPPER_BOUND;
+    } else if (value >= beta){
+        tte.flag = LOWER_BOUND;
+    } else {
+        tte.flag = EXACT;
+    }
+    tte.depth = depth;
+    tte.move = moves.at(best);
+
+    STAT_INC(state.stats, STAT_TT_STORES);
+    if(state.transposition_table.store(prev_hash, tte)){
+        STAT_INC(state.stats, STAT_TT_COLLISIONS);
+    }
+
+    return std::pair<int, Move>(value, moves.at(best));
+}
+
+void copyInfo(const SearchStats& stats, int depth, const std::vector<Move>& pv, SearchInfo* info){
+    if(info){
+        info->nodes = stats.counters[STAT_NODES];
+        info->qnodes = stats.counters[STAT_QNODES];
+        info->depth = depth;
+        info->seldepth = stats.seldepth;
+        info->pv = pv;
+        info->stats = stats;
+        info->forced = false;
+    }
+}
+
+std::vector<Move> rootPV(const SearchState& state){
+    return std::vector<Move>(state.pv[0], state.pv[0] + state.pv_length[0]);
+}
+
+std::pair<int, Move> searchRoot(Board& b, int depth, const ZobristTable& z_table, TranspositionTable& transposition_table, SearchInfo* info, SearchSignals* signals){
+    ThreadStats stats;
+    SearchState state(z_table, transposition_table, -1, stats);
+    state.signals = signals;
+
+    transposition_table.newSearch();
+
+    std::pair<int, Move> result = searchDepth(b, depth, INT_MIN+1, INT_MAX-1, state);
+    copyInfo(stats.snapshot(), depth, rootPV(state), info);
+
+    return result;
+}
+
+// Lazy SMP helpers skip depths in blocks of different size and phase so
+// that threads spread over neighbouring depths instead of all searching
+// the same one
+const int SKIP_SIZE[20] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+const int SKIP_PHASE[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+ThreadPool search_pool;
+
+struct IterationResult{
+    std::pair<int, Move> best;
+    std::vector<Move> pv;
+    int depth;
+};
+
+// Iterative deepening with aspiration windows. thread_index 0 is the main
+// thread and the only one that watches the soft time limit and reports
+// finished iterations; helpers run until they are stopped or reach max_depth.
+IterationResult iterativeDeepening(Board& b, int max_depth, const TimeBudget& budget, int thread_index, SearchState& state,
+                                   const std::function<void(const IterationResult&)>& report = nullptr){
+    IterationResult result{std::pair<int, Move>(0, NO_MOVE), std::vector<Move>(), 0};
+    int stable_iterations = 0;
+
+    for(int depth = 1; depth <= max_depth; depth++){
+        if(thread_index > 0){
+            int i = (thread_index - 1) % 20;
+            if(((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2 != 0){
+                continue;
+            }
+        }
+
+        int alpha = INT_MIN+1;
+        int beta = INT_MAX-1;
+        int delta = ASPIRATION_WINDOW;
+
+        if(depth >= ASPIRATION_DEPTH && result.depth > 0){
+            alpha = result.best.first - delta;
+            beta = result.best.first + delta;
+        }
+
+        // widen the failing side step by step until the score fits
+        std::pair<int, Move> iteration;
+        while(true){
+            iteration = searchDepth(b, depth, alpha, beta, state);
+
+            if(state.stopped){
+                break;
+            }
+
+            delta *= 2;
+            if(iteration.first <= alpha){
+                alpha = (delta > ASPIRATION_MAX) ? INT_MIN+1 : iteration.first - delta;
+            } else if (iteration.first >= beta){
+                beta = (delta > ASPIRATION_MAX) ? INT_MAX-1 : iteration.first + delta;
+            } else {
+                break;
+            }
+        }
+
+        // a move the aborted iteration already proved better is still played
+        if(state.stopped){
+            if(iteration.second != NO_MOVE){
+                result.best = iteration;
+                result.pv = rootPV(state);
+            }
+            break;
+        }
+
+        if(iteration.second == result.best.second){
+            stable_iterations++;
+        } else {
+            stable_iterations = 0;
+        }
+        result.best = iteration;
+        result.pv = rootPV(state);
+        result.depth = depth;
+
+        if(report){
+            report(result);
+        }
+
+        checkSignals(state);
+        if(state.stopped){
+            break;
+        }
+
+        if(thread_index == 0 && !state.pondering && budget.soft_ms >= 0){
+            int elapsed = budgetElapsedMs(state);
+
+            // the next iteration usually takes longer than all previous ones together
+            if(elapsed >= budget.soft_ms){
+                break;
+            }
+
+            if(stable_iterations >= STABLE_ITERATIONS && elapsed >= budget.soft_ms / 2){
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+std::pair<int, Move> searchIterative(Board& b, const SearchLimits& limits, const ZobristTable& z_table, TranspositionTable& transposition_table, SearchInfo* info, SearchSignals* signals){
+    std::vector<Move> moves = b.generateLegalMoves();
+
+    if(moves.empty()){
+        return std::pair<int, Move>(0, NO_MOVE);
+    }
+
+    bool forced = moves.size() == 1;
+
+    // only search the moves that keep the tablebase result
+    bool tb_root = filterRootMoves(b, moves);
+
+    // nothing to think about; the move is still reported as the pv, and the
+    // one move the tables leave keeps their score
+    if(moves.size() == 1){
+        int value = staticEvaluation(b, search_options);
+        int wdl;
+        if(tb_root && probeWDL(b, wdl)){
+            value = tbValue(wdl, 0);
+        }
+
+        // a reply the table holds from earlier searches is worth pondering on
+        std::vector<Move> pv(1, moves.at(0));
+        b.push(moves.at(0));
+        TTEntry t;
+        if(transposition_table.probe(hashZobrist(b, z_table), t) && t.move != NO_MOVE && b.isLegal(t.move)){
+            pv.push_back(t.move);
         }
-        
         b.pop();
+
+        copyInfo(SearchStats(), 0, pv, info);
+        if(info){
+            info->forced = forced;
+        }
+        return std::pair<int, Move>(value, moves.at(0));
+    }
+
+    TimeBudget budget = allocateTime(limits, b.turn);
+    int threads = std::max(1, search_options.threads);
+    std::vector<ThreadStats> thread_stats(threads);
+
+    SearchState state(z_table, transposition_table, budget.hard_ms, thread_stats.at(0));
+    state.signals = signals;
+    state.node_limit = limits.nodes;
+    state.all_stats = &thread_stats;
+    state.pondering = limits.ponder && signals;
+    if(tb_root){
+        state.root_moves = moves;
     }
 
-    return std::pair<int, Move>(alpha, moves.at(best));
-}
\ No newline at end of file
+    transposition_table.newSearch();
+
+    int max_depth = (limits.depth > 0) ? std::min(limits.depth, MAX_DEPTH) : MAX_DEPTH;
+
+    // helpers search their own copy of the position and only share the table
+    std::atomic<bool> stop_helpers(false);
+
+    search_pool.resize(threads - 1);
+    std::vector<Board> helper_boards(search_pool.size(), b);
+
+    search_pool.run([&](int index){
+        SearchState helper(z_table, transposition_table, -1, thread_stats.at(index + 1));
+        helper.shared_stop = &stop_helpers;
+        helper.root_moves = state.root_moves;
+
+        iterativeDeepening(helper_boards.at(index), max_depth, budget, index + 1, helper);
+    });
+
+    auto totalStats = [&](){
+        SearchStats total;
+        for(auto& stats: thread_stats){
+            total.add(stats.snapshot());
+        }
+        return total;
+    };
+
+    // effective branching factor: nodes of this iteration over the previous one
+    uint64_t reported_nodes = 0;
+    uint64_t previous_iteration_nodes = 0;
+    std::function<void(const IterationResult&)> report;
+    if(state.options.info_format != INFO_NONE){
+        report = [&](const IterationResult& iteration){
+            SearchStats total = totalStats();
+            uint64_t nodes = total.counters[STAT_NODES] + total.counters[STAT_QNODES];
+            uint64_t iteration_nodes = nodes - reported_nodes;
+            double ebf = previous_iteration_nodes ? (double)iteration_nodes / previous_iteration_nodes : 0.0;
+            reported_nodes = nodes;
+            previous_iteration_nodes = iteration_nodes;
+
+            // one write per line, a UCI front end prints from another thread
+            if(state.options.info_format == INFO_JSON){
+                std::cout << (formatInfoJSON(iteration.depth, iteration.best.first, total, elapsedMs(state), ebf, iteration.pv) + "\n") << std::flush;
+            } else {
+                std::cout << (formatInfoUCI(iteration.depth, iteration.best.first, total, elapsedMs(state), ebf, iteration.pv) + "\n") << std::flush;
+            }
+        };
+    }
+
+    IterationResult result = iterativeDeepening(b, max_depth, budget, 0, state, report);
+
+    stop_helpers = true;
+    search_pool.wait();
+
+    // ponder searches have no budget until the ponderhit, and none at all
+    // when they are stopped by a miss
+    if(!state.pondering){
+        move_latency.record(budgetElapsedMs(state), budget.hard_ms);
+    }
+
+    std::pair<int, Move> best = result.best;
+    if(best.second == NO_MOVE){
+        best = std::pair<int, Move>(0, moves.at(0));
+    }
+
+    copyInfo(totalStats(), result.depth, result.pv, info);
+
+    return best;
+}
@@ -1,13 +1,101 @@
 #pragma once
 
+#include <atomic>
+
 #include "board.h"
+#include "tt.h"
+#include "timeman.h"
+#include "stats.h"
+
+const int MAX_DEPTH = 64;
+
+const int MATE_SCORE = 30000;
+
+// iterations with the same best move after which the search may stop early
+const int STABLE_ITERATIONS = 3;
+
+// Formats of the per iteration output, see SearchOptions::info_format
+const int INFO_NONE = 0;
+const int INFO_UCI = 1;
+const int INFO_JSON = 2;
+
+// Selective search features, read when a search starts so they can be
+// switched off or retuned for depth versus strength comparisons
+struct SearchOptions{
+    // search threads including the main one, helpers share the TT (Lazy SMP)
+    int threads = 1;
+
+    bool null_move = true;
+    int null_move_min_depth = 3;
+
+    bool late_move_reductions = true;
+    int lmr_min_depth = 3;
+    int lmr_min_moves = 3;
+
+    // skip captures in quiescence that lose material by static exchange
+    bool see_pruning = true;
+
+    // per iteration output of searchIterative on stdout
+    int info_format = INFO_NONE;
+
+    // evaluate with the loaded NNUE network instead of the piece-square tables
+    bool use_nnue = false;
+
+    // per thread cache of static evaluations in kilobytes, 0 turns it off.
+    // Off by default: the piece-square evaluation is cheaper than a probe.
+    int eval_cache_kb = 0;
+
+    // Syzygy probes inside the search: positions with fewer pieces than
+    // the limit (and the largest table) are always probed, positions with
+    // exactly that many only from tb_probe_depth on
+    int tb_probe_depth = 1;
+    int tb_probe_limit = 7;
+};
+
+extern SearchOptions search_options;
+
+// Fixed seed so keys, and with them saved transposition tables, are the
+// same in every process
+const uint64_t ZOBRIST_SEED = 0x9e3779b97f4a7c15ULL;
 
 struct ZobristTable{
     BitBoard pieces[64][6][2];
     BitBoard castling_rights[4];
     BitBoard ep_files[8];
     BitBoard black_to_move;
+    uint64_t seed;
 };
 
-std::pair<int, Move> searchRoot(Board& b, int depth, const ZobristTable& table);
+// Result details of the last search: nodes visited (main search and
+// quiescence apart), the last completed depth and its principal variation
+struct SearchInfo{
+    uint64_t nodes = 0;
+    uint64_t qnodes = 0;
+    int depth = 0;
+    int seldepth = 0;
+    std::vector<Move> pv;
+    // the position had a single legal move, played without searching
+    bool forced = false;
+
+    // summed over all search threads
+    SearchStats stats;
+};
+
+// Set from another thread while searchIterative runs. stop ends the search
+// with the best move so far; ponderhit turns a ponder search into a normal
+// one that keeps its tree and starts honouring the time limits.
+struct SearchSignals{
+    std::atomic<bool> stop{false};
+    std::atomic<bool> ponderhit{false};
+};
+
+// Static score of the position for the side to move
+int evaluation(const Board& b);
+
+// Evaluation the search uses: the network when enabled and loaded,
+// otherwise evaluation(), kept clear of mate scores either way
+int staticEvaluation(const Board& b, const SearchOptions& options);
+
+std::pair<int, Move> searchRoot(Board& b, int depth, const ZobristTable& table, TranspositionTable& transposition_table, SearchInfo* info = nullptr, SearchSignals* signals = nullptr);
+std::pair<int, Move> searchIterative(Board& b, const SearchLimits& limits, const ZobristTable& table, TranspositionTable& transposition_table, SearchInfo* info = nullptr, SearchSignals* signals = nullptr);
 void initZobrist(ZobristTable& table);
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include "evalbatch.h"
+#include "positiontables.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EVAL_BATCH_X86
+#include <immintrin.h>
+#endif
+
+// Middlegame and endgame score packed in one int as mg + eg * 65536, so a
+// single addition updates both. Sums stay far inside the int16 halves.
+inline uint32_t packScore(int mg, int eg){
+    return ((uint32_t)eg << 16) + (uint32_t)mg;
+}
+
+inline int packedMg(uint32_t score){
+    return (int16_t)(uint16_t)score;
+}
+
+inline int packedEg(uint32_t score){
+    return (int16_t)(uint16_t)((score + 0x8000) >> 16);
+}
+
+// Packed material and piece-square score of each piece type on each
+// square, with the tables read from a1 (0) or from h8 (1)
+struct SquareScoreTable{
+    uint32_t scores[2][6][64];
+
+    SquareScoreTable(){
+        const int16_t* mg_tables[6] = {mg_pawn_table, mg_knight_table, mg_bishop_table, mg_rook_table, mg_queen_table, mg_king_table};
+        const int16_t* eg_tables[6] = {eg_pawn_table, eg_knight_table, eg_bishop_table, eg_rook_table, eg_queen_table, eg_king_table};
+
+        for(int reversed = 0; reversed < 2; reversed++){
+            for(int piece = 0; piece < 6; piece++){
+                for(int square = 0; square < 64; square++){
+                    int index = reversed ? 63 - square : square;
+                    scores[reversed][piece][square] = packScore(mg_material[piece + PAWN] + mg_tables[piece][index],
+                                                                eg_material[piece + PAWN] + eg_tables[piece][index]);
+                }
+            }
+        }
+    }
+};
+
+const SquareScoreTable SQUARE_SCORES;
+
+void PositionBatch::add(const Board& b){
+    BitBoard piece_masks[6] = {b.pawns, b.knights, b.bishops, b.rooks, b.queens, b.kings};
+
+    for(int color = 0; color < 2; color++){
+        for(int piece = 0; piece < 6; piece++){
+            pieces[color][piece].push_back(piece_masks[piece] & b.occupied_color[color]);
+        }
+    }
+    turn.push_back(b.turn);
+}
+
+void PositionBatch::clear(){
+    for(int color = 0; color < 2; color++){
+        for(int piece = 0; piece < 6; piece++){
+            pieces[color][piece].clear();
+        }
+    }
+    turn.clear();
+}
+
+size_t PositionBatch::size() const{
+    return turn.size();
+}
+
+// Same tapering and rounding as evaluation()
+inline int taperScore(uint32_t score, int game_phase){
+    int mg_phase = std::min(game_phase, 24);
+    int eg_phase = 24 - mg_phase;
+    return (packedMg(score) * mg_phase + packedEg(score) * eg_phase) / 24;
+}
+
+inline int gamePhase(const PositionBatch& batch, size_t i){
+    int phase = 0;
+    for(int piece = KNIGHT; piece <= QUEEN; piece++){
+        BitBoard bb = batch.pieces[WHITE][piece - PAWN][i] | batch.pieces[BLACK][piece - PAWN][i];
+        phase += phase_weights[piece] * __builtin_popcountll(bb);
+    }
+    return phase;
+}
+
+inline uint32_t bitboardScore(BitBoard bb, const uint32_t table[64]){
+    uint32_t score = 0;
+    while(bb){
+        score += table[lsb(bb)];
+        bb &= (bb - 1);
+    }
+    return score;
+}
+
+// The side to move reads the tables from h8, the other side from a1
+void evaluateScalar(const PositionBatch& batch, size_t begin, size_t end, int* scores){
+    for(size_t i = begin; i < end; i++){
+        Color us = batch.turn[i];
+
+        uint32_t score = 0;
+        for(int piece = 0; piece < 6; piece++){
+            score += bitboardScore(batch.pieces[us][piece][i], SQUARE_SCORES.scores[1][piece]);
+            score -= bitboardScore(batch.pieces[us ^ 1][piece][i], SQUARE_SCORES.scores[0][piece]);
+        }
+
+        scores[i] = taperScore(score, gamePhase(batch, i));
+    }
+}
+
+#ifdef EVAL_BATCH_X86
+
+// Gathers are slow on many CPUs, so the SIMD kernels expand bitboards bit
+// by bit instead: each square occupied in any lane adds its score to the
+// lanes that have it set. Lanes hold 32 bit halves of the bitboards.
+
+// Scores of 8 bitboards, given as two vectors of 4
+__attribute__((target("avx2,popcnt")))
+inline __m256i bitboardScoresAVX2(__m256i first, __m256i second, const uint32_t table[64]){
+    const __m256i even_odd = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    __m256i a = _mm256_permutevar8x32_epi32(first, even_odd);
+    __m256i b = _mm256_permutevar8x32_epi32(second, even_odd);
+    __m256i halves[2] = {_mm256_permute2x128_si256(a, b, 0x20), _mm256_permute2x128_si256(a, b, 0x31)};
+
+    __m256i score = _mm256_setzero_si256();
+    for(int half = 0; half < 2; half++){
+        // squares of this half occupied in any of the 8 bitboards
+        __m128i any = _mm_or_si128(_mm256_castsi256_si128(halves[half]), _mm256_extracti128_si256(halves[half], 1));
+        any = _mm_or_si128(any, _mm_srli_si128(any, 8));
+        any = _mm_or_si128(any, _mm_srli_si128(any, 4));
+        uint32_t squares = _mm_cvtsi128_si32(any);
+
+        while(squares){
+            int square = __builtin_ctz(squares);
+            __m256i bit = _mm256_set1_epi32(1u << square);
+            __m256i set = _mm256_cmpeq_epi32(_mm256_and_si256(halves[half], bit), bit);
+            score = _mm256_add_epi32(score, _mm256_and_si256(set, _mm256_set1_epi32(table[32 * half + square])));
+            squares &= squares - 1;
+        }
+    }
+    return score;
+}
+
+__attribute__((target("avx2,popcnt")))
+void evaluateAVX2(const PositionBatch& batch, size_t begin, size_t end, int* scores){
+    size_t i = begin;
+    for(; i + 8 <= end; i += 8){
+        // all bits set in the 64 bit lanes of positions with white to move
+        __m128i turns = _mm_loadl_epi64((const __m128i*)&batch.turn[i]);
+        __m256i white_first = _mm256_cmpeq_epi64(_mm256_cvtepu8_epi64(turns), _mm256_set1_epi64x(WHITE));
+        __m256i white_second = _mm256_cmpeq_epi64(_mm256_cvtepu8_epi64(_mm_srli_si128(turns, 4)), _mm256_set1_epi64x(WHITE));
+
+        __m256i score = _mm256_setzero_si256();
+        for(int piece = 0; piece < 6; piece++){
+            const BitBoard* white = &batch.pieces[WHITE][piece][i];
+            const BitBoard* black = &batch.pieces[BLACK][piece][i];
+
+            __m256i white_a = _mm256_loadu_si256((const __m256i*)white);
+            __m256i white_b = _mm256_loadu_si256((const __m256i*)(white + 4));
+            __m256i black_a = _mm256_loadu_si256((const __m256i*)black);
+            __m256i black_b = _mm256_loadu_si256((const __m256i*)(black + 4));
+
+            __m256i us_a = _mm256_blendv_epi8(black_a, white_a, white_first);
+            __m256i us_b = _mm256_blendv_epi8(black_b, white_b, white_second);
+            __m256i them_a = _mm256_blendv_epi8(white_a, black_a, white_first);
+            __m256i them_b = _mm256_blendv_epi8(white_b, black_b, white_second);
+
+            score = _mm256_add_epi32(score, bitboardScoresAVX2(us_a, us_b, SQUARE_SCORES.scores[1][piece]));
+            score = _mm256_sub_epi32(score, bitboardScoresAVX2(them_a, them_b, SQUARE_SCORES.scores[0][piece]));
+        }
+
+        uint32_t packed[8];
+        _mm256_storeu_si256((__m256i*)packed, score);
+        for(int j = 0; j < 8; j++){
+            scores[i + j] = taperScore(packed[j], gamePhase(batch, i + j));
+        }
+    }
+
+    evaluateScalar(batch, i, end, scores);
+}
+
+// Scores of 16 bitboards, given as two vectors of 8. Only intrinsics that
+// set every lane are used, the ones leaving lanes undefined set off GCC's
+// -Wmaybe-uninitialized.
+__attribute__((target("avx512f,popcnt")))
+inline __m512i bitboardScoresAVX512(__m512i first, __m512i second, const uint32_t table[64]){
+    const __m512i low_halves = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i high_halves = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    __m512i halves[2] = {_mm512_permutex2var_epi32(first, low_halves, second), _mm512_permutex2var_epi32(first, high_halves, second)};
+
+    __m512i score = _mm512_setzero_si512();
+    for(int half = 0; half < 2; half++){
+        // squares of this half occupied in any of the 16 bitboards
+        __m512i any = _mm512_or_si512(halves[half], _mm512_maskz_shuffle_i64x2(0xff, halves[half], halves[half], _MM_SHUFFLE(1, 0, 3, 2)));
+        any = _mm512_or_si512(any, _mm512_maskz_shuffle_i64x2(0xff, any, any, _MM_SHUFFLE(2, 3, 0, 1)));
+        any = _mm512_or_si512(any, _mm512_maskz_shuffle_epi32(0xffff, any, _MM_PERM_BADC));
+        any = _mm512_or_si512(any, _mm512_maskz_shuffle_epi32(0xffff, any, _MM_PERM_CDAB));
+        uint32_t squares = _mm512_cvtsi512_si32(any);
+
+        while(squares){
+            int square = __builtin_ctz(squares);
+            __mmask16 set = _mm512_test_epi32_mask(halves[half], _mm512_set1_epi32(1u << square));
+            score = _mm512_mask_add_epi32(score, set, score, _mm512_set1_epi32(table[32 * half + square]));
+            squares &= squares - 1;
+        }
+    }
+    return score;
+}
+
+__attribute__((target("avx512f,popcnt")))
+void evaluateAVX512(const PositionBatch& batch, size_t begin, size_t end, int* scores){
+    size_t i = begin;
+    for(; i + 16 <= end; i += 16){
+        // one bit per position with white to move
+        __m128i turns = _mm_loadu_si128((const __m128i*)&batch.turn[i]);
+        uint32_t white = _mm_movemask_epi8(_mm_cmpeq_epi8(turns, _mm_set1_epi8(WHITE)));
+        __mmask8 white_first = white & 0xff;
+        __mmask8 white_second = white >> 8;
+
+        __m512i score = _mm512_setzero_si512();
+        for(int piece = 0; piece < 6; piece++){
+            const BitBoard* white = &batch.pieces[WHITE][piece][i];
+            const BitBoard* black = &batch.pieces[BLACK][piece][i];
+
+            __m512i white_a = _mm512_loadu_si512(white);
+            __m512i white_b = _mm512_loadu_si512(white + 8);
+            __m512i black_a = _mm512_loadu_si512(black);
+            __m512i black_b = _mm512_loadu_si512(black + 8);
+
+            __m512i us_a = _mm512_mask_blend_epi64(white_first, black_a, white_a);
+            __m512i us_b = _mm512_mask_blend_epi64(white_second, black_b, white_b);
+            __m512i them_a = _mm512_mask_blend_epi64(white_first, white_a, black_a);
+            __m512i them_b = _mm512_mask_blend_epi64(white_second, white_b, black_b);
+
+            score = _mm512_add_epi32(score, bitboardScoresAVX512(us_a, us_b, SQUARE_SCORES.scores[1][piece]));
+            score = _mm512_sub_epi32(score, bitboardScoresAVX512(them_a, them_b, SQUARE_SCORES.scores[0][piece]));
+        }
+
+        uint32_t packed[16];
+        _mm512_storeu_si512(packed, score);
+        for(int j = 0; j < 16; j++){
+            scores[i + j] = taperScore(packed[j], gamePhase(batch, i + j));
+        }
+    }
+
+    evaluateScalar(batch, i, end, scores);
+}
+
+#endif
+
+int bestEvalKernel(){
+#ifdef EVAL_BATCH_X86
+    if(__builtin_cpu_supports("avx512f")){
+        return EVAL_KERNEL_AVX512;
+    }
+    if(__builtin_cpu_supports("avx2")){
+        return EVAL_KERNEL_AVX2;
+    }
+#endif
+    return EVAL_KERNEL_SCALAR;
+}
+
+void evaluateBatch(const PositionBatch& batch, std::vector<int>& scores, int kernel){
+    scores.resize(batch.size());
+
+    int best = bestEvalKernel();
+    if(kernel == EVAL_KERNEL_AUTO || kernel > best){
+        kernel = best;
+    }
+
+#ifdef EVAL_BATCH_X86
+    if(kernel == EVAL_KERNEL_AVX512){
+        evaluateAVX512(batch, 0, batch.size(), scores.data());
+        return;
+    }
+    if(kernel == EVAL_KERNEL_AVX2){
+        evaluateAVX2(batch, 0, batch.size(), scores.data());
+        return;
+    }
+#endif
+    evaluateScalar(batch, 0, batch.size(), scores.data());
+}
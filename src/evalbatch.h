@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "board.h"
+#include "constants.h"
+
+// Positions laid out as structure of arrays for evaluating many of them at
+// once: pieces[color][piecetype - PAWN][i] is that bitboard of position i.
+struct PositionBatch{
+    std::vector<BitBoard> pieces[2][6];
+    std::vector<uint8_t> turn;
+
+    void add(const Board& b);
+    void clear();
+    size_t size() const;
+};
+
+const int EVAL_KERNEL_AUTO = 0;
+const int EVAL_KERNEL_SCALAR = 1;
+const int EVAL_KERNEL_AVX2 = 2;
+const int EVAL_KERNEL_AVX512 = 3;
+
+// Fastest kernel this CPU supports
+int bestEvalKernel();
+
+// Scores every position of the batch exactly as evaluation() scores the
+// same Board. A kernel the CPU lacks falls back to the best one it has.
+void evaluateBatch(const PositionBatch& batch, std::vector<int>& scores, int kernel = EVAL_KERNEL_AUTO);
@@ -0,0 +1,57 @@
+#include "evalcache.h"
+
+#include <algorithm>
+
+EvalCache::EvalCache(size_t kb){
+    mask = 0;
+    resize(kb);
+}
+
+// Round down to a power of two number of slots so the index is a mask
+void EvalCache::resize(size_t kb){
+    size_t target = (kb * 1024) / sizeof(Slot);
+
+    size_t count = 0;
+    if(target > 0){
+        count = 1;
+        while(count * 2 <= target){
+            count *= 2;
+        }
+    }
+
+    slots.assign(count, Slot{0, 0});
+    mask = count ? count - 1 : 0;
+}
+
+void EvalCache::clear(){
+    std::fill(slots.begin(), slots.end(), Slot{0, 0});
+}
+
+bool EvalCache::enabled() const{
+    return !slots.empty();
+}
+
+// Key 0 marks an empty slot, the one position hashing to it is never cached
+bool EvalCache::probe(uint64_t key, int& score) const{
+    if(slots.empty() || key == 0){
+        return false;
+    }
+
+    const Slot& slot = slots[key & mask];
+    if(slot.key != key){
+        return false;
+    }
+    score = slot.score;
+    return true;
+}
+
+void EvalCache::store(uint64_t key, int score){
+    if(slots.empty()){
+        return;
+    }
+    slots[key & mask] = Slot{key, score};
+}
+
+size_t EvalCache::size() const{
+    return slots.size();
+}
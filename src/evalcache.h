@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Direct-mapped cache of static evaluations, one per search thread so it
+// needs no synchronisation. A slot holds the full Zobrist key, a new score
+// always replaces the old one.
+class EvalCache{
+    struct Slot{
+        uint64_t key;
+        int32_t score;
+    };
+
+    std::vector<Slot> slots;
+    size_t mask;
+
+    public:
+        // kb of 0 disables the cache, every probe misses
+        EvalCache(size_t kb = 0);
+
+        void resize(size_t kb);
+        void clear();
+
+        bool enabled() const;
+
+        bool probe(uint64_t key, int& score) const;
+        void store(uint64_t key, int score);
+
+        size_t size() const;
+};
@@ -0,0 +1,432 @@
+#include "fen.h"
+#include "board.h"
+
+#include <cstring>
+
+const char PIECE_SYMBOLS[2][7] = {{' ', 'p', 'n', 'b', 'r', 'q', 'k'}, {' ', 'P', 'N', 'B', 'R', 'Q', 'K'}};
+
+// castling flags in FEN order with the rook square each one stands for
+const char CASTLING_FLAGS[5] = "KQkq";
+const Square CASTLING_ROOKS[4] = {H1, A1, H8, A8};
+
+// Largest clock accepted, keeps the digits of any parsed FEN bounded
+const int FEN_MAX_CLOCK = 999999;
+
+bool fail(FENError& error, const char* message, size_t offset){
+    error.message = message;
+    error.offset = offset;
+    return false;
+}
+
+inline bool isSpace(char c){
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Next whitespace separated field from pos on, empty at the end of input.
+// start is where the field begins, for error offsets.
+std::string_view nextField(std::string_view s, size_t& pos, size_t& start){
+    while(pos < s.size() && isSpace(s[pos])){
+        pos++;
+    }
+    start = pos;
+    while(pos < s.size() && !isSpace(s[pos])){
+        pos++;
+    }
+    return s.substr(start, pos - start);
+}
+
+bool parseClock(std::string_view field, int& value){
+    if(field.empty() || field.size() > 6){
+        return false;
+    }
+    value = 0;
+    for(char c: field){
+        if(c < '0' || c > '9'){
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return value <= FEN_MAX_CLOCK;
+}
+
+int pieceFromSymbol(char c, Color& color){
+    for(int piecetype = PAWN; piecetype <= KING; piecetype++){
+        if(c == PIECE_SYMBOLS[WHITE][piecetype]){
+            color = WHITE;
+            return piecetype;
+        } else if (c == PIECE_SYMBOLS[BLACK][piecetype]){
+            color = BLACK;
+            return piecetype;
+        }
+    }
+    return NO_PIECE;
+}
+
+bool parseBoardFEN(std::string_view placement, BaseBoard& b, FENError& error){
+    b.clearBoard();
+
+    int rank = 7;
+    int file = 0;
+    for(size_t i = 0; i < placement.size(); i++){
+        char c = placement[i];
+        Color color;
+        PieceType piecetype;
+
+        if(c == '/'){
+            if(file != 8 || rank == 0){
+                return fail(error, "rank does not have 8 squares", i);
+            }
+            rank--;
+            file = 0;
+        } else if (c >= '1' && c <= '8'){
+            file += c - '0';
+            if(file > 8){
+                return fail(error, "rank has more than 8 squares", i);
+            }
+        } else if ((piecetype = pieceFromSymbol(c, color)) != NO_PIECE){
+            if(file >= 8){
+                return fail(error, "rank has more than 8 squares", i);
+            }
+            if(piecetype == PAWN && (rank == 0 || rank == 7)){
+                return fail(error, "pawn on the first or last rank", i);
+            }
+            b.setPieceAt(8 * rank + file, piecetype, color);
+            file++;
+        } else {
+            return fail(error, "unexpected character in piece placement", i);
+        }
+    }
+
+    if(rank != 0 || file != 8){
+        return fail(error, "piece placement does not have 8 ranks of 8 squares", placement.size());
+    }
+
+    if(popcount(b.kings & b.occupied_color[WHITE]) != 1 || popcount(b.kings & b.occupied_color[BLACK]) != 1){
+        return fail(error, "each side needs exactly one king", 0);
+    }
+
+    return true;
+}
+
+// Parses the four position fields, pos is left after them
+bool parsePosition(std::string_view fen, Board& b, size_t& pos, FENError& error){
+    size_t start;
+
+    std::string_view placement = nextField(fen, pos, start);
+    if(!parseBoardFEN(placement, b, error)){
+        error.offset += start;
+        return false;
+    }
+
+    std::string_view turn = nextField(fen, pos, start);
+    if(turn == "w"){
+        b.turn = WHITE;
+    } else if (turn == "b"){
+        b.turn = BLACK;
+    } else {
+        return fail(error, "side to move is not w or b", start);
+    }
+
+    std::string_view castling = nextField(fen, pos, start);
+    b.castling_rights = BB_EMPTY;
+    if(castling != "-"){
+        if(castling.empty() || castling.size() > 4){
+            return fail(error, "castling rights are not - or a combination of KQkq", start);
+        }
+        for(size_t i = 0; i < castling.size(); i++){
+            const char* flag = std::strchr(CASTLING_FLAGS, castling[i]);
+            if(castling[i] == '\0' || !flag){
+                return fail(error, "castling rights are not - or a combination of KQkq", start + i);
+            }
+
+            int index = flag - CASTLING_FLAGS;
+            Color color = index < 2 ? WHITE : BLACK;
+            Square king_square = color == WHITE ? E1 : E8;
+            Square rook_square = CASTLING_ROOKS[index];
+
+            BitBoard own = b.occupied_color[color];
+            if((b.kings & own & BB_SQUARES[king_square]) && (b.rooks & own & BB_SQUARES[rook_square])){
+                b.castling_rights |= BB_SQUARES[rook_square];
+            }
+        }
+    }
+
+    std::string_view ep = nextField(fen, pos, start);
+    b.ep_square = NO_SQUARE;
+    if(ep != "-"){
+        int ep_rank = (b.turn == WHITE) ? 5 : 2;
+        if(ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] - '1' != ep_rank){
+            return fail(error, "en passant square is not - or a square behind a pawn that just moved", start);
+        }
+        b.ep_square = 8 * ep_rank + (ep[0] - 'a');
+
+        // the pawn stands in front of the square it passed, which is empty
+        // like the square it came from
+        int forward = (b.turn == WHITE) ? -8 : 8;
+        BitBoard pawn = BB_SQUARES[b.ep_square + forward];
+        BitBoard passed = BB_SQUARES[b.ep_square] | BB_SQUARES[b.ep_square - forward];
+        if(!(b.pawns & b.occupied_color[b.turn ^ 1] & pawn) || (b.occupied & passed)){
+            return fail(error, "en passant square is not - or a square behind a pawn that just moved", start);
+        }
+    }
+
+    if(b.isAttackedBy(b.turn, b.king(b.turn ^ 1))){
+        return fail(error, "side not to move is in check", 0);
+    }
+
+    return true;
+}
+
+bool parseFEN(std::string_view fen, Board& b, FENError& error){
+    b.clearBoard();
+
+    size_t pos = 0, start;
+    if(!parsePosition(fen, b, pos, error)){
+        return false;
+    }
+
+    std::string_view halfmove = nextField(fen, pos, start);
+    if(!halfmove.empty() && !parseClock(halfmove, b.halfmove_clock)){
+        return fail(error, "halfmove clock is not a number", start);
+    }
+
+    std::string_view fullmove = nextField(fen, pos, start);
+    if(!fullmove.empty() && (!parseClock(fullmove, b.fullmove_number) || b.fullmove_number == 0)){
+        return fail(error, "fullmove number is not a positive number", start);
+    }
+
+    if(!nextField(fen, pos, start).empty()){
+        return fail(error, "unexpected text after the fullmove number", start);
+    }
+
+    return true;
+}
+
+// Appends to a fixed buffer, remembering when it ran out of room
+struct FENWriter{
+    char* buffer;
+    size_t size;
+    size_t length;
+    bool overflow;
+
+    FENWriter(char* buffer, size_t size): buffer(buffer), size(size), length(0), overflow(size == 0){}
+
+    void put(char c){
+        if(length + 1 < size){
+            buffer[length++] = c;
+        } else {
+            overflow = true;
+        }
+    }
+
+    void put(std::string_view s){
+        for(char c: s){
+            put(c);
+        }
+    }
+
+    void putNumber(int value){
+        char digits[12];
+        int count = 0;
+        unsigned int magnitude = value < 0 ? -(unsigned int)value : value;
+        do{
+            digits[count++] = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while(magnitude);
+
+        if(value < 0){
+            put('-');
+        }
+        while(count){
+            put(digits[--count]);
+        }
+    }
+
+    size_t finish(){
+        if(overflow){
+            if(size){
+                buffer[0] = '\0';
+            }
+            return 0;
+        }
+        buffer[length] = '\0';
+        return length;
+    }
+};
+
+void writePosition(const Board& b, FENWriter& out){
+    for(int rank = 7; rank >= 0; rank--){
+        int empty = 0;
+        for(int file = 0; file < 8; file++){
+            Square square = 8 * rank + file;
+            if(!(b.occupied & BB_SQUARES[square])){
+                empty++;
+                continue;
+            }
+            if(empty){
+                out.put('0' + empty);
+                empty = 0;
+            }
+            out.put(PIECE_SYMBOLS[b.colorAt(square)][b.pieceTypeAt(square)]);
+        }
+        if(empty){
+            out.put('0' + empty);
+        }
+        if(rank){
+            out.put('/');
+        }
+    }
+
+    out.put(b.turn == WHITE ? " w " : " b ");
+
+    if(!b.castling_rights){
+        out.put('-');
+    } else {
+        for(int i = 0; i < 4; i++){
+            if(b.castling_rights & BB_SQUARES[CASTLING_ROOKS[i]]){
+                out.put(CASTLING_FLAGS[i]);
+            }
+        }
+    }
+
+    out.put(' ');
+    if(b.ep_square == NO_SQUARE){
+        out.put('-');
+    } else {
+        out.put('a' + squareFile(b.ep_square));
+        out.put('1' + squareRank(b.ep_square));
+    }
+}
+
+size_t writeFEN(const Board& b, char* buffer, size_t size){
+    FENWriter out(buffer, size);
+    writePosition(b, out);
+    out.put(' ');
+    out.putNumber(b.halfmove_clock);
+    out.put(' ');
+    out.putNumber(b.fullmove_number);
+    return out.finish();
+}
+
+// Operand of an EPD operation: a quoted string, or a token ending at
+// whitespace or ';'. Empty at a ';' or the end of input.
+bool nextOperand(std::string_view epd, size_t& pos, std::string_view& operand, FENError& error){
+    while(pos < epd.size() && isSpace(epd[pos])){
+        pos++;
+    }
+
+    if(pos < epd.size() && epd[pos] == '"'){
+        size_t end = epd.find('"', pos + 1);
+        if(end == std::string_view::npos){
+            return fail(error, "unterminated string operand", pos);
+        }
+        operand = epd.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+        return true;
+    }
+
+    size_t start = pos;
+    while(pos < epd.size() && !isSpace(epd[pos]) && epd[pos] != ';'){
+        pos++;
+    }
+    operand = epd.substr(start, pos - start);
+    return true;
+}
+
+bool parseEPD(std::string_view epd, Board& b, EPDRecord& record, FENError& error){
+    b.clearBoard();
+    record = EPDRecord();
+
+    size_t pos = 0;
+    if(!parsePosition(epd, b, pos, error)){
+        return false;
+    }
+
+    while(true){
+        size_t start;
+        std::string_view opcode = nextField(epd, pos, start);
+        if(opcode.empty()){
+            return true;
+        }
+
+        // an operation without operands may run into its ';'
+        bool terminated = false;
+        if(opcode.back() == ';'){
+            opcode.remove_suffix(1);
+            terminated = true;
+        }
+
+        while(!terminated){
+            std::string_view operand;
+            if(!nextOperand(epd, pos, operand, error)){
+                return false;
+            }
+
+            if(pos < epd.size() && epd[pos] == ';'){
+                pos++;
+                terminated = true;
+            } else if (pos >= epd.size() && operand.empty()){
+                return fail(error, "operation is not terminated by ';'", start);
+            }
+
+            if(operand.empty()){
+                continue;
+            }
+
+            if(opcode == "bm" || opcode == "am"){
+                bool best = opcode == "bm";
+                int& count = best ? record.best_move_count : record.avoid_move_count;
+                if(count == EPD_MAX_MOVES){
+                    return fail(error, "too many moves in operation", start);
+                }
+                (best ? record.best_moves : record.avoid_moves)[count++] = operand;
+            } else if (opcode == "id"){
+                record.id = operand;
+            } else if (opcode == "c0"){
+                record.comment = operand;
+            } else if (opcode == "hmvc"){
+                if(!parseClock(operand, b.halfmove_clock)){
+                    return fail(error, "halfmove clock is not a number", start);
+                }
+            } else if (opcode == "fmvn"){
+                if(!parseClock(operand, b.fullmove_number) || b.fullmove_number == 0){
+                    return fail(error, "fullmove number is not a positive number", start);
+                }
+            }
+        }
+    }
+}
+
+void writeMoves(FENWriter& out, const char* opcode, const std::string_view* moves, int count){
+    if(!count){
+        return;
+    }
+    out.put(' ');
+    out.put(opcode);
+    for(int i = 0; i < count; i++){
+        out.put(' ');
+        out.put(moves[i]);
+    }
+    out.put(';');
+}
+
+void writeString(FENWriter& out, const char* opcode, std::string_view value){
+    if(value.empty()){
+        return;
+    }
+    out.put(' ');
+    out.put(opcode);
+    out.put(" \"");
+    out.put(value);
+    out.put("\";");
+}
+
+size_t writeEPD(const Board& b, const EPDRecord& record, char* buffer, size_t size){
+    FENWriter out(buffer, size);
+    writePosition(b, out);
+    writeMoves(out, "bm", record.best_moves, record.best_move_count);
+    writeMoves(out, "am", record.avoid_moves, record.avoid_move_count);
+    writeString(out, "id", record.id);
+    writeString(out, "c0", record.comment);
+    return out.finish();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "constants.h"
+
+class BaseBoard;
+class Board;
+
+// Buffer size that fits any FEN writeFEN produces, '\0' included
+const size_t FEN_MAX_LENGTH = 128;
+
+// First problem found while parsing, offset is where in the input it is.
+// Messages are string literals, so reporting an error allocates nothing.
+struct FENError{
+    const char* message = nullptr;
+    size_t offset = 0;
+};
+
+// Piece placement only, the first field of a FEN. The board is cleared
+// first; false when the placement is malformed.
+bool parseBoardFEN(std::string_view placement, BaseBoard& b, FENError& error);
+
+// Full FEN. The clocks may be left out, as in EPD, and default to 0 and 1.
+// Castling rights without the king and rook on their squares are dropped.
+// Rejects malformed fields, missing kings, pawns on the back ranks, en
+// passant squares no pawn can just have passed and positions where the
+// side not to move is in check. On failure the board
+// is left cleared or partly set up.
+bool parseFEN(std::string_view fen, Board& b, FENError& error);
+
+// Writes the FEN of b and a terminating '\0' into buffer. Returns the
+// length without the '\0', or 0 when size is too small.
+size_t writeFEN(const Board& b, char* buffer, size_t size);
+
+// Operations of an EPD line that the analysis tools use. Strings and moves
+// are views into the parsed line, which has to outlive the record; moves
+// are kept in SAN as written. Other opcodes are skipped, except hmvc and
+// fmvn which set the clocks of the board.
+const int EPD_MAX_MOVES = 8;
+
+struct EPDRecord{
+    std::string_view best_moves[EPD_MAX_MOVES];
+    int best_move_count = 0;
+
+    std::string_view avoid_moves[EPD_MAX_MOVES];
+    int avoid_move_count = 0;
+
+    // without the quotes
+    std::string_view id;
+    std::string_view comment;
+};
+
+// Four FEN fields followed by operations: opcode, operands, ';'
+bool parseEPD(std::string_view epd, Board& b, EPDRecord& record, FENError& error);
+
+// Writes the four EPD fields of b and the operations of record, like
+// writeFEN
+size_t writeEPD(const Board& b, const EPDRecord& record, char* buffer, size_t size);
@@ -0,0 +1,170 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "board.h"
+#include "fen.h"
+
+using namespace std;
+
+// Positions used without an input file: openings, middlegames with
+// castling and en passant, endgames
+const char* BENCH_POSITIONS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "rnbqkb1r/pp1p1ppp/4pn2/2pP4/2P5/8/PP2PPPP/RNBQKBNR w KQkq c6 0 4",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1BBPPP/R2QK2R w KQ - 3 9",
+    "2r3k1/1q1nbppp/r3p3/3pP3/pPpP4/P1Q2N2/2RN1PPP/2R4K b - b3 0 23",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "8/8/4k3/8/2p5/8/B2K4/8 b - - 12 60",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+};
+
+// EPD lines carry operations after the position, so they get more room
+// than FEN_MAX_LENGTH
+const size_t EPD_BENCH_MAX_LENGTH = 1024;
+
+bool sameRecord(const EPDRecord& a, const EPDRecord& b){
+    if(a.best_move_count != b.best_move_count || a.avoid_move_count != b.avoid_move_count || a.id != b.id || a.comment != b.comment){
+        return false;
+    }
+    for(int i = 0; i < a.best_move_count; i++){
+        if(a.best_moves[i] != b.best_moves[i]){
+            return false;
+        }
+    }
+    for(int i = 0; i < a.avoid_move_count; i++){
+        if(a.avoid_moves[i] != b.avoid_moves[i]){
+            return false;
+        }
+    }
+    return true;
+}
+
+double secondsSince(chrono::steady_clock::time_point start){
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Parse and write throughput of the FEN/EPD codec:
+//   fen-bench [positions.epd] [rounds]
+int main(int argc, char* argv[]){
+    string contents;
+    vector<string_view> lines;
+
+    if(argc > 1 && string(argv[1]) != "-"){
+        ifstream in(argv[1], ios::binary);
+        if(!in){
+            cout << "Could not open " << argv[1] << endl;
+            return 1;
+        }
+        stringstream buffer;
+        buffer << in.rdbuf();
+        contents = buffer.str();
+
+        string_view view(contents);
+        size_t start = 0;
+        while(start < view.size()){
+            size_t end = view.find('\n', start);
+            if(end == string_view::npos){
+                end = view.size();
+            }
+            if(end > start){
+                lines.push_back(view.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+    } else {
+        for(const char* fen: BENCH_POSITIONS){
+            lines.push_back(fen);
+        }
+    }
+
+    int rounds = argc > 2 ? stoi(argv[2]) : max<int>(1, 4000000 / max<size_t>(1, lines.size()));
+
+    Board b;
+    EPDRecord record;
+    FENError error;
+    char buffer[EPD_BENCH_MAX_LENGTH];
+
+    // each line is classified once: FEN when it parses as one, otherwise
+    // EPD. The first invalid line shows what the parser rejects.
+    vector<char> is_epd(lines.size(), 0);
+    vector<Board> boards;
+    vector<EPDRecord> records;
+    vector<char> board_is_epd;
+    bool reported = false;
+    for(size_t i = 0; i < lines.size(); i++){
+        if(parseFEN(lines[i], b, error)){
+            record = EPDRecord();
+        } else if (parseEPD(lines[i], b, record, error)){
+            is_epd[i] = 1;
+        } else {
+            if(!reported){
+                cout << "line " << i + 1 << ": " << error.message << " at offset " << error.offset << endl;
+                reported = true;
+            }
+            continue;
+        }
+        boards.push_back(b);
+        records.push_back(record);
+        board_is_epd.push_back(is_epd[i]);
+    }
+
+    uint64_t parsed = 0, failed = 0;
+    auto start = chrono::steady_clock::now();
+    for(int round = 0; round < rounds; round++){
+        for(size_t i = 0; i < lines.size(); i++){
+            bool ok = is_epd[i] ? parseEPD(lines[i], b, record, error) : parseFEN(lines[i], b, error);
+            parsed += ok;
+            failed += !ok;
+        }
+    }
+    double parse_seconds = secondsSince(start);
+
+    uint64_t written = 0, bytes = 0;
+    start = chrono::steady_clock::now();
+    for(int round = 0; round < rounds; round++){
+        for(size_t i = 0; i < boards.size(); i++){
+            if(board_is_epd[i]){
+                bytes += writeEPD(boards[i], records[i], buffer, sizeof(buffer));
+            } else {
+                bytes += writeFEN(boards[i], buffer, sizeof(buffer));
+            }
+            written++;
+        }
+    }
+    double write_seconds = secondsSince(start);
+
+    // every written line has to parse back to the same position, and EPD
+    // to the same operations; EPD keeps no clocks
+    uint64_t mismatches = 0;
+    for(size_t i = 0; i < boards.size(); i++){
+        const Board& board = boards[i];
+        Board parsed_back;
+        EPDRecord record_back;
+        bool ok;
+        if(board_is_epd[i]){
+            ok = writeEPD(board, records[i], buffer, sizeof(buffer)) && parseEPD(buffer, parsed_back, record_back, error) &&
+                 sameRecord(records[i], record_back);
+        } else {
+            ok = writeFEN(board, buffer, sizeof(buffer)) && parseFEN(buffer, parsed_back, error) &&
+                 parsed_back.halfmove_clock == board.halfmove_clock && parsed_back.fullmove_number == board.fullmove_number;
+        }
+        if(!ok || !(parsed_back == board) || parsed_back.turn != board.turn ||
+           parsed_back.castling_rights != board.castling_rights || parsed_back.ep_square != board.ep_square){
+            mismatches++;
+        }
+    }
+
+    cout << lines.size() << " positions, " << rounds << " rounds" << endl;
+    cout << "parse: " << (uint64_t)(parsed / max(parse_seconds, 1e-9)) << " positions/s, " << failed / rounds << " invalid" << endl;
+    cout << "write: " << (uint64_t)(written / max(write_seconds, 1e-9)) << " positions/s, "
+         << (uint64_t)(bytes / max(write_seconds, 1e-9) / (1024 * 1024)) << " MB/s" << endl;
+    cout << "round trip mismatches: " << mismatches << endl;
+
+    return mismatches ? 1 : 0;
+}
@@ -1,43 +1,176 @@
 #include <iostream>
 #include <cstdint>
+#include <thread>
 
+#include <unistd.h>
+
+#include "batch.h"
 #include "engine.h"
 #include "board.h"
+#include "nnue.h"
+#include "syzygy.h"
+#include "uci.h"
 
 using namespace std;
 
-int main(){
+// thinking time per engine move in milliseconds
+const int ENGINE_MOVE_TIME = 5000;
+
+// eval cache per search thread once the network evaluation is used
+const int NNUE_EVAL_CACHE_KB = 32;
+
+int main(int argc, char* argv[]){
     Board b = Board();
 
     ZobristTable table;
     initZobrist(table);
 
-    while(b.gameOutcome() == NO_OUTCOME){
+    // offline analysis of a position file, see batchMain for the options
+    if(argc > 1 && string(argv[1]) == "batch"){
+        return batchMain(argc - 2, argv + 2, table);
+    }
+
+    // a GUI opens with uci, or starts the engine as "chess-engine uci ...".
+    // Piped input is checked for it before anything is printed, so stdout
+    // only ever carries the protocol; a terminal gets the console game.
+    bool uci_mode = argc > 1 && string(argv[1]) == "uci";
+    if(uci_mode){
+        argc--;
+        argv++;
+    }
+    string first_input;
+    if(!uci_mode && !isatty(STDIN_FILENO)){
+        cin >> first_input;
+        uci_mode = first_input == "uci";
+    }
+
+    // messages about the files below would break the protocol on stdout
+    ostream& log = uci_mode ? cerr : cout;
+
+    TranspositionTable transposition_table(UCI_DEFAULT_HASH_MB);
+
+    // optional transposition table dump to warm start from and save to
+    string tt_path;
+    if(argc > 1){
+        tt_path = argv[1];
+        if(transposition_table.load(tt_path, table.seed)){
+            log << "Loaded transposition table from " << tt_path << endl;
+        }
+    }
+
+    // optional NNUE network, the piece-square evaluation is used without one
+    if(argc > 2){
+        if(loadNetwork(argv[2])){
+            search_options.use_nnue = true;
+            search_options.eval_cache_kb = NNUE_EVAL_CACHE_KB;
+            log << "Loaded network from " << argv[2] << endl;
+        } else {
+            log << "Could not load network from " << argv[2] << endl;
+        }
+    }
+
+    // optional Syzygy tablebase directories separated by ':'
+    if(argc > 3){
+        log << "Found " << initTablebases(argv[3]) << " tablebases in " << argv[3] << endl;
+    }
+
+    if(uci_mode){
+        uciLoop(table, transposition_table);
+    }
+
+    // expected reply from the last search, searched while the player thinks
+    Move ponder_move = NO_MOVE;
+
+    while(!uci_mode && b.gameOutcome() == NO_OUTCOME){
         b.print();
+
+        SearchLimits limits;
+        limits.movetime = ENGINE_MOVE_TIME;
+
+        SearchSignals signals;
+        SearchInfo info;
+        std::pair<int, Move> ponder_result(0, NO_MOVE);
+
+        Board ponder_board = b;
+        thread ponder_thread;
+        if(ponder_move != NO_MOVE){
+            ponder_board.push(ponder_move);
+
+            SearchLimits ponder_limits = limits;
+            ponder_limits.ponder = true;
+
+            ponder_thread = thread([&, ponder_limits]{
+                ponder_result = searchIterative(ponder_board, ponder_limits, table, transposition_table, &info, &signals);
+            });
+        }
+
         cout << "Enter a move: ";
 
-        string uci;
-        cin >> uci;
+        // a move read while checking for uci is the first one played
+        string uci = first_input;
+        first_input.clear();
+        if(uci.empty()){
+            cin >> uci;
+        }
+
         Move m = Move(uci);
 
-        while(!b.isLegal(m)){
+        while(cin && !b.isLegal(m)){
             cout << "Move not legal.\nEnter a move: ";
             cin >> uci;
             m = Move(uci);
         }
 
+        // the end of piped input ends the game
+        if(!cin){
+            signals.stop = true;
+            if(ponder_thread.joinable()){
+                ponder_thread.join();
+            }
+            break;
+        }
+
+        // a ponder hit carries on with the tree already searched and the
+        // full move time from now on, a miss stops it and only keeps what
+        // went into the transposition table
+        bool ponder_hit = ponder_move != NO_MOVE && m == ponder_move;
+        if(ponder_thread.joinable()){
+            if(ponder_hit){
+                signals.ponderhit = true;
+            } else {
+                signals.stop = true;
+            }
+            ponder_thread.join();
+        }
+
         b.pushUCI(uci);
 
         if(b.gameOutcome() != NO_OUTCOME){
             break;
         }
 
-        std::pair<int, Move> best_move = searchRoot(b, 6, table);
+        std::pair<int, Move> best_move;
+        if(ponder_hit){
+            best_move = ponder_result;
+        } else {
+            best_move = searchIterative(b, limits, table, transposition_table, &info);
+        }
+
         cout << best_move.second.toUCI() << endl;
         b.push(best_move.second);
 
+        ponder_move = (info.pv.size() >= 2 && info.pv.at(0) == best_move.second) ? info.pv.at(1) : NO_MOVE;
+
         cout << endl;
     }
 
+    if(move_latency.count() > 0){
+        log << move_latency.summary() << endl;
+    }
+
+    if(!tt_path.empty() && !transposition_table.save(tt_path, table.seed)){
+        log << "Could not save transposition table to " << tt_path << endl;
+    }
+
     return 0;
-}
\ No newline at end of file
+}
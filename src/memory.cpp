@@ -0,0 +1,64 @@
+#include "memory.h"
+
+#include <cstdlib>
+#include <cstdint>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+const size_t PAGE_SIZE = 4096;
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static size_t roundUp(size_t bytes, size_t alignment){
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+void* allocLarge(size_t bytes, bool lock_pages){
+    size_t size = roundUp(bytes, HUGE_PAGE_SIZE);
+    void* mem = nullptr;
+
+#ifdef __linux__
+    // explicit hugetlbfs pages first, then transparent huge pages
+    mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(mem == MAP_FAILED){
+        mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mem == MAP_FAILED){
+            return nullptr;
+        }
+        madvise(mem, size, MADV_HUGEPAGE);
+    }
+#else
+    mem = std::aligned_alloc(HUGE_PAGE_SIZE, size);
+    if(!mem){
+        return nullptr;
+    }
+#endif
+
+    // touch every page now instead of during the first search
+    volatile uint8_t* bytes_ptr = (volatile uint8_t*)mem;
+    for(size_t i = 0; i < size; i += PAGE_SIZE){
+        bytes_ptr[i] = 0;
+    }
+
+#ifdef __linux__
+    // best effort, RLIMIT_MEMLOCK is usually too small for a full table
+    if(lock_pages){
+        mlock(mem, size);
+    }
+#endif
+
+    return mem;
+}
+
+void freeLarge(void* mem, size_t bytes){
+    if(!mem){
+        return;
+    }
+
+#ifdef __linux__
+    munmap(mem, roundUp(bytes, HUGE_PAGE_SIZE));
+#else
+    std::free(mem);
+#endif
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+
+// Page-aligned allocation for large search tables. Backed by huge pages
+// where the OS allows it and pre-faulted so the first search does not
+// pay for page faults. Returns nullptr on failure.
+void* allocLarge(size_t bytes, bool lock_pages);
+void freeLarge(void* mem, size_t bytes);
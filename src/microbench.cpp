@@ -0,0 +1,162 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "engine.h"
+#include "evalbatch.h"
+#include "positiontables.h"
+
+using namespace std;
+
+// Middlegame positions with plenty of captures on defended squares
+const char* MICRO_BENCH_POSITIONS[] = {
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1BBPPP/R2QK2R w KQ - 3 9",
+    "2r3k1/1q1nbppp/r3p3/3pP3/pPpP4/P1Q2N2/2RN1PPP/2R4K b - b3 0 23",
+    "r2q1rk1/pp1nbppp/2p1pn2/3p4/2PP4/1PN1PN2/PB2BPPP/R2Q1RK1 w - - 1 10",
+    "3r3k/3r4/2n1n3/8/3p4/2PR4/1B1Q4/3R3K w - - 0 1",
+    "2r2r1k/6bp/p7/2q2p1Q/3PpP2/1B6/P5PP/2RR3K b - - 0 1",
+};
+
+const int MICRO_BENCH_ROUNDS = 200000;
+
+double nanosecondsSince(chrono::steady_clock::time_point start){
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+// Static exchange evaluation of every legal capture
+void benchSEE(){
+    vector<pair<Board, Move>> captures;
+    for(const char* fen: MICRO_BENCH_POSITIONS){
+        Board b(fen);
+        for(const Move& move: b.generateLegalCaptures()){
+            captures.push_back({b, move});
+        }
+    }
+
+    long long sum = 0;
+    auto start = chrono::steady_clock::now();
+    for(int round = 0; round < MICRO_BENCH_ROUNDS; round++){
+        for(auto& [b, move]: captures){
+            sum += b.see(move);
+        }
+    }
+    double ns = nanosecondsSince(start) / ((double)MICRO_BENCH_ROUNDS * captures.size());
+
+    cout << "see: " << captures.size() << " captures, " << ns << " ns per call (checksum " << sum << ")" << endl;
+}
+
+const int16_t* MG_TABLES[7] = {nullptr, mg_pawn_table, mg_knight_table, mg_bishop_table, mg_rook_table, mg_queen_table, mg_king_table};
+const int16_t* EG_TABLES[7] = {nullptr, eg_pawn_table, eg_knight_table, eg_bishop_table, eg_rook_table, eg_queen_table, eg_king_table};
+
+// The tapered score summed over every piece, as evaluation() did before the
+// board kept it up to date
+int evaluationFromScratch(const Board& b){
+    int mg_value = 0, eg_value = 0, game_phase = 0;
+
+    BitBoard bb = b.occupied;
+    while(bb){
+        Square square = lsb(bb);
+        PieceType piecetype = b.pieceTypeAt(square);
+        bool own = b.colorAt(square) == b.turn;
+        int index = own ? 63 - square : square;
+        int sign = own ? 1 : -1;
+
+        mg_value += sign * (mg_material[piecetype] + MG_TABLES[piecetype][index]);
+        eg_value += sign * (eg_material[piecetype] + EG_TABLES[piecetype][index]);
+        game_phase += phase_weights[piecetype];
+        bb &= (bb - 1);
+    }
+
+    int mg_phase = std::min(game_phase, 24);
+    int eg_phase = 24 - mg_phase;
+    return (mg_value * mg_phase + eg_value * eg_phase) / 24;
+}
+
+// Incremental evaluation against recomputing the score from every piece
+void benchEval(){
+    vector<Board> boards;
+    for(const char* fen: MICRO_BENCH_POSITIONS){
+        boards.push_back(Board(fen));
+    }
+
+    for(size_t i = 0; i < boards.size(); i++){
+        if(evaluation(boards.at(i)) != evaluationFromScratch(boards.at(i))){
+            cout << "eval: incremental score differs from scratch in " << MICRO_BENCH_POSITIONS[i] << endl;
+            return;
+        }
+    }
+
+    long long sum = 0;
+    auto start = chrono::steady_clock::now();
+    for(int round = 0; round < MICRO_BENCH_ROUNDS; round++){
+        for(const Board& b: boards){
+            sum += evaluationFromScratch(b);
+        }
+    }
+    double scratch_ns = nanosecondsSince(start) / ((double)MICRO_BENCH_ROUNDS * boards.size());
+
+    start = chrono::steady_clock::now();
+    for(int round = 0; round < MICRO_BENCH_ROUNDS; round++){
+        for(const Board& b: boards){
+            sum += evaluation(b);
+        }
+    }
+    double incremental_ns = nanosecondsSince(start) / ((double)MICRO_BENCH_ROUNDS * boards.size());
+
+    cout << "eval: " << scratch_ns << " ns from scratch, " << incremental_ns << " ns incremental (checksum " << sum << ")" << endl;
+}
+
+// Every batch kernel this CPU has, over positions from random games
+void benchEvalBatch(){
+    PositionBatch batch;
+    mt19937 rng(7);
+    for(const char* fen: MICRO_BENCH_POSITIONS){
+        for(int game = 0; game < 100; game++){
+            Board b(fen);
+            for(int ply = 0; ply < 40; ply++){
+                vector<Move> moves = b.generateLegalMoves();
+                if(moves.empty()){
+                    break;
+                }
+                b.push(moves[rng() % moves.size()]);
+                batch.add(b);
+            }
+        }
+    }
+
+    int rounds = MICRO_BENCH_ROUNDS / 1000;
+    for(int kernel = EVAL_KERNEL_SCALAR; kernel <= bestEvalKernel(); kernel++){
+        vector<int> scores;
+        long long sum = 0;
+        auto start = chrono::steady_clock::now();
+        for(int round = 0; round < rounds; round++){
+            evaluateBatch(batch, scores, kernel);
+            sum += scores.back();
+        }
+        double ns = nanosecondsSince(start) / ((double)rounds * batch.size());
+
+        cout << "evalbatch kernel " << kernel << ": " << batch.size() << " positions, " << ns << " ns per position (checksum " << sum << ")" << endl;
+    }
+}
+
+// Timings of small hot routines:
+//   micro-bench [see|eval|evalbatch]
+int main(int argc, char* argv[]){
+    string only = argc > 1 ? argv[1] : "";
+
+    if(only.empty() || only == "see"){
+        benchSEE();
+    }
+    if(only.empty() || only == "eval"){
+        benchEval();
+    }
+    if(only.empty() || only == "evalbatch"){
+        benchEvalBatch();
+    }
+
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "constants.h"
 #include "move.h"
 
+#include <cstring>
 #include <string>
 
 Move::Move(Square from, Square to, PieceType p){
@@ -9,77 +10,89 @@ Move::Move(Square from, Square to, PieceType p){
     promotion = p;
 }
 
+// Same as NO_MOVE
+Move::Move(){
+    from_square = NO_SQUARE;
+    to_square = NO_SQUARE;
+    promotion = -1;
+}
+
 Move::Move(Square from, Square to){
     from_square = from;
     to_square = to;
     promotion = NO_PIECE;
 }
 
-bool Move::operator == (const Move& move){
+bool Move::operator == (const Move& move) const{
     if(move.from_square == from_square && move.to_square == to_square && move.promotion == promotion){
         return true;
     }
     return false;
 }
 
-bool Move::operator != (const Move& move){
+bool Move::operator != (const Move& move) const{
     if(move.from_square == from_square && move.to_square == to_square && move.promotion == promotion){
         return false;
     }
     return true;
 }
 
-std::string Move::toUCI(){
-    std::string promotion_letter;
-
-    switch(promotion){
-        case QUEEN:
-            promotion_letter = "q";
-            break;
-        case ROOK:
-            promotion_letter = "r";
-            break;
-        case BISHOP:
-            promotion_letter = "b";
-            break;
-        case KNIGHT:
-            promotion_letter = "n";
-            break;
-        default:
-            promotion_letter = "";
+// Promotion letters by piece type, ' ' where there is none
+const char PROMOTION_LETTERS[7] = {' ', ' ', 'n', 'b', 'r', 'q', ' '};
+
+size_t Move::writeUCI(char* buffer) const{
+    if(from_square >= 64 || to_square >= 64){
+        std::memcpy(buffer, "0000", 5);
+        return 4;
     }
 
-    return SQUARE_NAMES[(int)from_square] + SQUARE_NAMES[(int)to_square] + promotion_letter;
+    buffer[0] = 'a' + (from_square & 7);
+    buffer[1] = '1' + (from_square >> 3);
+    buffer[2] = 'a' + (to_square & 7);
+    buffer[3] = '1' + (to_square >> 3);
+
+    size_t length = 4;
+    if(promotion >= KNIGHT && promotion <= QUEEN){
+        buffer[length++] = PROMOTION_LETTERS[promotion];
+    }
+    buffer[length] = '\0';
+    return length;
 }
 
-Move::Move(std::string uci){
-    if(uci.length() == 4){
-        for(int i = 0; i < 64; i++){
-            if(uci.substr(0, 2) == SQUARE_NAMES[i]){
-                from_square = i;
-            }
+std::string Move::toUCI() const{
+    char buffer[UCI_MAX_LENGTH];
+    return std::string(buffer, writeUCI(buffer));
+}
 
-            if(uci.substr(2, 2) == SQUARE_NAMES[i]){
-                to_square = i;
-            }
-        }
-        promotion = NO_PIECE;
-    } else if(uci.length() == 5){
-        for(int i = 0; i < 64; i++){
-            if(uci.substr(0, 2) == SQUARE_NAMES[i]){
-                from_square = i;
-            }
-
-            if(uci.substr(2, 2) == SQUARE_NAMES[i]){
-                to_square = i;
-            }
-        }
+// Square of a file letter and rank digit, NO_SQUARE when out of range
+inline Square parseSquare(char file, char rank){
+    if(file < 'a' || file > 'h' || rank < '1' || rank > '8'){
+        return NO_SQUARE;
+    }
+    return 8 * (rank - '1') + (file - 'a');
+}
+
+Move::Move(std::string_view uci): Move(){
+    if(uci.length() != 4 && uci.length() != 5){
+        return;
+    }
+
+    Square from = parseSquare(uci[0], uci[1]);
+    Square to = parseSquare(uci[2], uci[3]);
+    if(from == NO_SQUARE || to == NO_SQUARE){
+        return;
+    }
 
-        char piece_codes[4] = {'n', 'b', 'r', 'q'};
-        for(int i = 0; i < 6; i++){
-            if(uci.at(4) == piece_codes[i]){
-                promotion = i+2;
-            }
+    PieceType p = NO_PIECE;
+    if(uci.length() == 5){
+        const char* letter = (const char*)std::memchr(PROMOTION_LETTERS + KNIGHT, uci[4], QUEEN - KNIGHT + 1);
+        if(!letter){
+            return;
         }
+        p = letter - PROMOTION_LETTERS;
     }
+
+    from_square = from;
+    to_square = to;
+    promotion = p;
 }
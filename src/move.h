@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
+#include <string_view>
 
 #include "constants.h"
 
@@ -10,14 +12,25 @@ class Move{
         Square to_square;
         PieceType promotion;
 
+        Move();
         Move(Square from, Square to);
         Move(Square from, Square to, PieceType p);
-        Move(std::string uci);
+        // NO_MOVE unless uci is two squares and an optional promotion
+        // letter, "0000" included
+        Move(std::string_view uci);
 
-        bool operator == (const Move& move);
-        bool operator != (const Move& move);
+        bool operator == (const Move& move) const;
+        bool operator != (const Move& move) const;
 
-        std::string toUCI();
+        // Writes the UCI notation and a terminating '\0', buffer needs
+        // UCI_MAX_LENGTH chars. Returns the length without the '\0'.
+        size_t writeUCI(char* buffer) const;
+        std::string toUCI() const;
 };
 
-const Move NO_MOVE = Move(-1, -1, -1);
\ No newline at end of file
+// "e7e8q" and the '\0'
+const size_t UCI_MAX_LENGTH = 6;
+
+const Move NO_MOVE = Move(-1, -1, -1);
+// what Board::pushNull puts on the move stack, written as 0000 like NO_MOVE
+const Move NULL_MOVE = Move(-2, -2, -1);
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "nnue.h"
+#include "board.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NNUE_X86
+#include <immintrin.h>
+#endif
+
+// feature index = king square * NNUE_KING_STRIDE + 1 + piece * 64 + square,
+// with piece = (piece type - pawn) * 2, plus one for the other side: own
+// pawn, other pawn, own knight, other knight and so on up to the queens
+const int NNUE_KING_STRIDE = 641;
+
+// first layer output is clipped to 0..NNUE_CLIP, layer sums are scaled back
+// by 2^NNUE_WEIGHT_SHIFT and the output by NNUE_OUTPUT_SCALE
+const int NNUE_CLIP = 127;
+const int NNUE_WEIGHT_SHIFT = 6;
+const int NNUE_OUTPUT_SCALE = 16;
+
+struct Network{
+    alignas(32) int16_t ft_biases[NNUE_HIDDEN];
+    alignas(32) int16_t ft_weights[NNUE_FEATURES][NNUE_HIDDEN];
+
+    alignas(32) int32_t l1_biases[NNUE_L2];
+    alignas(32) int8_t l1_weights[NNUE_L2][2 * NNUE_HIDDEN];
+
+    alignas(32) int32_t l2_biases[NNUE_L3];
+    alignas(32) int8_t l2_weights[NNUE_L3][NNUE_L2];
+
+    int32_t output_bias;
+    alignas(32) int8_t output_weights[NNUE_L3];
+};
+
+std::unique_ptr<Network> network;
+
+template <typename T>
+bool readArray(std::ifstream& file, T* data, size_t count){
+    return (bool)file.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+}
+
+bool loadNetwork(const std::string& path){
+    std::ifstream file(path, std::ios::binary);
+    if(!file){
+        return false;
+    }
+
+    char magic[8];
+    uint32_t header[6];
+    if(!readArray(file, magic, 8) || std::memcmp(magic, NNUE_FILE_MAGIC, 8) != 0 || !readArray(file, header, 6)){
+        return false;
+    }
+
+    const uint32_t expected[6] = {NNUE_FILE_VERSION, NNUE_FEATURES, NNUE_HIDDEN, NNUE_L2, NNUE_L3, 1};
+    if(!std::equal(header, header + 6, expected)){
+        return false;
+    }
+
+    std::unique_ptr<Network> loaded(new Network());
+    bool ok = readArray(file, loaded->ft_biases, NNUE_HIDDEN) &&
+              readArray(file, &loaded->ft_weights[0][0], (size_t)NNUE_FEATURES * NNUE_HIDDEN) &&
+              readArray(file, loaded->l1_biases, NNUE_L2) &&
+              readArray(file, &loaded->l1_weights[0][0], NNUE_L2 * 2 * NNUE_HIDDEN) &&
+              readArray(file, loaded->l2_biases, NNUE_L3) &&
+              readArray(file, &loaded->l2_weights[0][0], NNUE_L3 * NNUE_L2) &&
+              readArray(file, &loaded->output_bias, 1) &&
+              readArray(file, loaded->output_weights, NNUE_L3);
+
+    // trailing bytes mean the file was written for a different layout
+    if(!ok || file.peek() != std::ifstream::traits_type::eof()){
+        return false;
+    }
+
+    network = std::move(loaded);
+    return true;
+}
+
+bool networkLoaded(){
+    return network != nullptr;
+}
+
+// Black sees the board mirrored vertically, so both perspectives share weights
+inline int featureIndex(Color perspective, Square king_square, Square square, PieceType piecetype, Color color){
+    if(perspective == BLACK){
+        king_square ^= 56;
+        square ^= 56;
+    }
+    int piece = (piecetype - PAWN) * 2 + (color != perspective);
+    return king_square * NNUE_KING_STRIDE + 1 + piece * 64 + square;
+}
+
+#ifdef NNUE_X86
+
+__attribute__((target("avx2")))
+void addWeightsAVX2(int16_t* values, const int16_t* weights){
+    for(int i = 0; i < NNUE_HIDDEN; i += 16){
+        __m256i v = _mm256_load_si256((const __m256i*)(values + i));
+        __m256i w = _mm256_load_si256((const __m256i*)(weights + i));
+        _mm256_store_si256((__m256i*)(values + i), _mm256_add_epi16(v, w));
+    }
+}
+
+__attribute__((target("avx2")))
+void subWeightsAVX2(int16_t* values, const int16_t* weights){
+    for(int i = 0; i < NNUE_HIDDEN; i += 16){
+        __m256i v = _mm256_load_si256((const __m256i*)(values + i));
+        __m256i w = _mm256_load_si256((const __m256i*)(weights + i));
+        _mm256_store_si256((__m256i*)(values + i), _mm256_sub_epi16(v, w));
+    }
+}
+
+// Dot products of `outputs` int8 weight rows with uint8 inputs, plus biases
+__attribute__((target("avx2")))
+void affineAVX2(const uint8_t* input, int inputs, const int8_t* weights, const int32_t* biases, int outputs, int32_t* result){
+    const __m256i ones = _mm256_set1_epi16(1);
+    for(int o = 0; o < outputs; o++){
+        const int8_t* row = weights + o * inputs;
+
+        __m256i sum = _mm256_setzero_si256();
+        for(int i = 0; i < inputs; i += 32){
+            __m256i in = _mm256_load_si256((const __m256i*)(input + i));
+            __m256i w = _mm256_load_si256((const __m256i*)(row + i));
+            __m256i products = _mm256_maddubs_epi16(in, w);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+        result[o] = biases[o] + _mm_cvtsi128_si32(s);
+    }
+}
+
+bool hasAVX2(){
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#else
+
+bool hasAVX2(){
+    return false;
+}
+
+void addWeightsAVX2(int16_t*, const int16_t*){}
+void subWeightsAVX2(int16_t*, const int16_t*){}
+void affineAVX2(const uint8_t*, int, const int8_t*, const int32_t*, int, int32_t*){}
+
+#endif
+
+void addWeights(int16_t* values, const int16_t* weights){
+    if(hasAVX2()){
+        addWeightsAVX2(values, weights);
+        return;
+    }
+    for(int i = 0; i < NNUE_HIDDEN; i++){
+        values[i] += weights[i];
+    }
+}
+
+void subWeights(int16_t* values, const int16_t* weights){
+    if(hasAVX2()){
+        subWeightsAVX2(values, weights);
+        return;
+    }
+    for(int i = 0; i < NNUE_HIDDEN; i++){
+        values[i] -= weights[i];
+    }
+}
+
+// maddubs saturates pairs of products at int16 where the scalar path does
+// not; clipped inputs keep trained weights far from that
+void affine(const uint8_t* input, int inputs, const int8_t* weights, const int32_t* biases, int outputs, int32_t* result){
+    if(hasAVX2()){
+        affineAVX2(input, inputs, weights, biases, outputs, result);
+        return;
+    }
+    for(int o = 0; o < outputs; o++){
+        int32_t sum = biases[o];
+        for(int i = 0; i < inputs; i++){
+            sum += input[i] * weights[o * inputs + i];
+        }
+        result[o] = sum;
+    }
+}
+
+inline uint8_t clippedRelu(int32_t value){
+    return (uint8_t)std::clamp(value >> NNUE_WEIGHT_SHIFT, 0, NNUE_CLIP);
+}
+
+// Accumulator of one perspective from scratch
+void refreshAccumulator(const Board& b, Accumulator& accumulator, Color perspective){
+    int16_t* values = accumulator.values[perspective];
+    std::copy(network->ft_biases, network->ft_biases + NNUE_HIDDEN, values);
+
+    Square king_square = b.king(perspective);
+    BitBoard pieces = b.occupied & ~b.kings;
+    while(pieces){
+        Square square = lsb(pieces);
+        addWeights(values, network->ft_weights[featureIndex(perspective, king_square, square, b.pieceTypeAt(square), b.colorAt(square))]);
+        pieces &= pieces - 1;
+    }
+    accumulator.computed[perspective] = true;
+}
+
+// Brings the top accumulator up to date from the closest computed one
+// below it, unless a king move of this perspective or a board setup lies
+// in between, where only a refresh is correct
+void updateAccumulator(const Board& b, Color perspective){
+    std::vector<Accumulator>& stack = b.accumulators;
+    int top = b.accumulator_top;
+
+    int base = top;
+    while(!stack[base].computed[perspective]){
+        const Accumulator& entry = stack[base];
+        bool own_king_moved = false;
+        for(int i = 0; i < entry.dirty_count; i++){
+            own_king_moved |= entry.dirty[i].piecetype == KING && entry.dirty[i].color == perspective;
+        }
+
+        if(base == 0 || entry.overflow || own_king_moved){
+            refreshAccumulator(b, stack[top], perspective);
+            return;
+        }
+        base--;
+    }
+
+    Square king_square = b.king(perspective);
+    for(int i = base + 1; i <= top; i++){
+        Accumulator& entry = stack[i];
+        std::copy(stack[i - 1].values[perspective], stack[i - 1].values[perspective] + NNUE_HIDDEN, entry.values[perspective]);
+
+        for(int j = 0; j < entry.dirty_count; j++){
+            const DirtyPiece& dirty = entry.dirty[j];
+            if(dirty.piecetype == KING){
+                continue;
+            }
+
+            const int16_t* weights = network->ft_weights[featureIndex(perspective, king_square, dirty.square, dirty.piecetype, dirty.color)];
+            if(dirty.added){
+                addWeights(entry.values[perspective], weights);
+            } else {
+                subWeights(entry.values[perspective], weights);
+            }
+        }
+        entry.computed[perspective] = true;
+    }
+}
+
+int evaluateNNUE(const Board& b){
+    updateAccumulator(b, WHITE);
+    updateAccumulator(b, BLACK);
+
+    const Accumulator& accumulator = b.accumulators[b.accumulator_top];
+
+    // side to move first
+    alignas(32) uint8_t input[2 * NNUE_HIDDEN];
+    for(int side = 0; side < 2; side++){
+        const int16_t* values = accumulator.values[side == 0 ? b.turn : b.turn ^ 1];
+        for(int i = 0; i < NNUE_HIDDEN; i++){
+            input[side * NNUE_HIDDEN + i] = (uint8_t)std::clamp<int>(values[i], 0, NNUE_CLIP);
+        }
+    }
+
+    alignas(32) int32_t l1_sums[NNUE_L2];
+    alignas(32) uint8_t l1_output[NNUE_L2];
+    affine(input, 2 * NNUE_HIDDEN, &network->l1_weights[0][0], network->l1_biases, NNUE_L2, l1_sums);
+    for(int i = 0; i < NNUE_L2; i++){
+        l1_output[i] = clippedRelu(l1_sums[i]);
+    }
+
+    alignas(32) int32_t l2_sums[NNUE_L3];
+    alignas(32) uint8_t l2_output[NNUE_L3];
+    affine(l1_output, NNUE_L2, &network->l2_weights[0][0], network->l2_biases, NNUE_L3, l2_sums);
+    for(int i = 0; i < NNUE_L3; i++){
+        l2_output[i] = clippedRelu(l2_sums[i]);
+    }
+
+    int32_t output;
+    affine(l2_output, NNUE_L3, network->output_weights, &network->output_bias, 1, &output);
+    return output / NNUE_OUTPUT_SCALE;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "constants.h"
+
+class Board;
+
+// HalfKP network: every non-king piece seen from each side's king square
+// feeds NNUE_HIDDEN accumulators per side, followed by two clipped ReLU
+// layers of 32 and a single output.
+const int NNUE_FEATURES = 64 * 641;
+const int NNUE_HIDDEN = 256;
+const int NNUE_L2 = 32;
+const int NNUE_L3 = 32;
+
+// Weight files start with the magic, the version and the five layer sizes
+// as uint32, followed by little endian arrays: int16 accumulator biases and
+// weights (feature major), then for each of the three layers after it the
+// int32 biases and int8 weights (output major).
+const char NNUE_FILE_MAGIC[8] = {'C', 'E', 'N', 'N', 'U', 'E', 'V', '1'};
+const uint32_t NNUE_FILE_VERSION = 1;
+
+// Pieces added or removed by one move; a move touches at most four
+struct DirtyPiece{
+    Square square;
+    PieceType piecetype;
+    Color color;
+    bool added;
+};
+
+const int MAX_DIRTY_PIECES = 4;
+
+// First layer output of one position for both perspectives. Each pushed
+// move gets one, built from its parent and the dirty pieces when needed.
+struct Accumulator{
+    alignas(32) int16_t values[2][NNUE_HIDDEN];
+    bool computed[2];
+
+    DirtyPiece dirty[MAX_DIRTY_PIECES];
+    int dirty_count;
+    bool overflow;
+};
+
+bool loadNetwork(const std::string& path);
+bool networkLoaded();
+
+// Network score for the side to move, in centipawns
+int evaluateNNUE(const Board& b);
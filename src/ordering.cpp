@@ -0,0 +1,114 @@
+#include "ordering.h"
+
+#include <algorithm>
+
+OrderingTables::OrderingTables(){
+    use_countermoves = true;
+    clear();
+}
+
+void OrderingTables::clear(){
+    for(int i = 0; i < MAX_PLY; i++){
+        killers[i][0] = NO_MOVE;
+        killers[i][1] = NO_MOVE;
+    }
+
+    for(int i = 0; i < 64; i++){
+        for(int j = 0; j < 64; j++){
+            history[WHITE][i][j] = 0;
+            history[BLACK][i][j] = 0;
+            countermoves[i][j] = NO_MOVE;
+        }
+    }
+}
+
+// MVV-LVA: most valuable victim first, cheapest attacker breaks ties
+int mvvLva(const Board& b, const Move& move){
+    PieceType victim = b.pieceTypeAt(move.to_square);
+    if(victim == NO_PIECE && b.isEnPassant(move)){
+        victim = PAWN;
+    }
+    PieceType attacker = b.pieceTypeAt(move.from_square);
+
+    return victim * 8 - attacker;
+}
+
+// Taking a piece worth at least the capturer never loses material, so the
+// exchange only needs to be played out for the remaining captures
+bool isLosingCapture(const Board& b, const Move& move){
+    if(move.promotion == NO_PIECE && SEE_VALUES[b.pieceTypeAt(move.to_square)] >= SEE_VALUES[b.pieceTypeAt(move.from_square)]){
+        return false;
+    }
+    return b.see(move) < 0;
+}
+
+void scoreMoves(const Board& b, const std::vector<Move>& moves, const OrderingTables& tables, int ply, std::vector<int>& scores){
+    scores.resize(moves.size());
+
+    Move counter = NO_MOVE;
+    if(tables.use_countermoves){
+        Move last = b.peek();
+        if(last != NO_MOVE && last != NULL_MOVE){
+            counter = tables.countermoves[last.from_square][last.to_square];
+        }
+    }
+
+    for(int i = 0; i < moves.size(); i++){
+        Move move = moves.at(i);
+
+        if(b.isCapture(move) || move.promotion != NO_PIECE){
+            int band = isLosingCapture(b, move) ? BAD_CAPTURE_SCORE : CAPTURE_SCORE;
+            scores.at(i) = band + mvvLva(b, move) + move.promotion * 64;
+        } else if (move == tables.killers[ply][0]){
+            scores.at(i) = KILLER_SCORE + 1;
+        } else if (move == tables.killers[ply][1]){
+            scores.at(i) = KILLER_SCORE;
+        } else if (move == counter){
+            scores.at(i) = COUNTER_SCORE;
+        } else {
+            scores.at(i) = tables.history[b.turn][move.from_square][move.to_square];
+        }
+    }
+}
+
+// Selection sort step: bring the best scored move at or after index to index
+void pickMove(std::vector<Move>& moves, std::vector<int>& scores, int index){
+    int best = index;
+    for(int i = index + 1; i < moves.size(); i++){
+        if(scores.at(i) > scores.at(best)){
+            best = i;
+        }
+    }
+
+    std::swap(moves.at(index), moves.at(best));
+    std::swap(scores.at(index), scores.at(best));
+}
+
+// Record a beta cutoff. Quiet moves tried before the cutoff move are penalised.
+void updateOrdering(OrderingTables& tables, const Board& b, const Move& move, const std::vector<Move>& quiets_tried, int depth, int ply){
+    if(b.isCapture(move) || move.promotion != NO_PIECE){
+        return;
+    }
+
+    if(tables.killers[ply][0] != move){
+        tables.killers[ply][1] = tables.killers[ply][0];
+        tables.killers[ply][0] = move;
+    }
+
+    int bonus = std::min(depth * depth, HISTORY_MAX / 64);
+
+    int& entry = tables.history[b.turn][move.from_square][move.to_square];
+    entry = std::min(entry + bonus, HISTORY_MAX);
+
+    for(auto quiet: quiets_tried){
+        int& other = tables.history[b.turn][quiet.from_square][quiet.to_square];
+        other = std::max(other - bonus, -HISTORY_MAX);
+    }
+
+    if(tables.use_countermoves){
+        Move last = b.peek();
+        if(last != NO_MOVE && last != NULL_MOVE){
+            tables.countermoves[last.from_square][last.to_square] = move;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "board.h"
+#include "move.h"
+
+const int MAX_PLY = 128;
+
+// Captures and promotions that do not lose material come first, then
+// killers, the countermove, quiet moves by history score, which stays
+// within +-HISTORY_MAX, and last the captures that lose material.
+const int CAPTURE_SCORE = 1000000;
+const int KILLER_SCORE = 900000;
+const int COUNTER_SCORE = 800000;
+const int HISTORY_MAX = 400000;
+const int BAD_CAPTURE_SCORE = -1000000;
+
+// Move ordering state kept for the length of one search: two killer moves
+// per ply, a butterfly history table indexed by side, from and to square,
+// and optionally the move that last refuted each previous move.
+struct OrderingTables{
+    Move killers[MAX_PLY][2];
+    int history[2][64][64];
+    Move countermoves[64][64];
+
+    bool use_countermoves;
+
+    OrderingTables();
+
+    void clear();
+};
+
+void scoreMoves(const Board& b, const std::vector<Move>& moves, const OrderingTables& tables, int ply, std::vector<int>& scores);
+void pickMove(std::vector<Move>& moves, std::vector<int>& scores, int index);
+
+void updateOrdering(OrderingTables& tables, const Board& b, const Move& move, const std::vector<Move>& quiets_tried, int depth, int ply);
@@ -1,3 +1,8 @@
+/* material and game phase weights, indexed by piece type */
+const int16_t mg_material[7] = {0, 82, 337, 365, 477, 1025, 0};
+const int16_t eg_material[7] = {0, 94, 281, 297, 512, 936, 0};
+const int16_t phase_weights[7] = {0, 0, 1, 1, 2, 4, 0};
+
 /* piece/sq tables */
 /* values from Rofchade: http://www.talkchess.com/forum3/viewtopic.php?f=2&t=68311&start=19 */
 
@@ -0,0 +1,149 @@
+#include "stats.h"
+#include "engine.h"
+#include "ordering.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+
+ThreadStats::ThreadStats(){
+    clear();
+}
+
+void ThreadStats::clear(){
+    for(int i = 0; i < STAT_COUNT; i++){
+        counters[i].store(0, std::memory_order_relaxed);
+    }
+    seldepth.store(0, std::memory_order_relaxed);
+}
+
+SearchStats ThreadStats::snapshot() const{
+    SearchStats stats;
+    for(int i = 0; i < STAT_COUNT; i++){
+        stats.counters[i] = counters[i].load(std::memory_order_relaxed);
+    }
+    stats.seldepth = seldepth.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void SearchStats::add(const SearchStats& other){
+    for(int i = 0; i < STAT_COUNT; i++){
+        counters[i] += other.counters[i];
+    }
+    seldepth = std::max(seldepth, other.seldepth);
+}
+
+#ifdef SEARCH_STATS
+static double hitRate(uint64_t a, uint64_t b){
+    return b ? (double)a / b : 0.0;
+}
+#endif
+
+double evalCacheSavedMs(const SearchStats& stats){
+    if(!stats.counters[STAT_EVAL_TIMED_PROBES] || !stats.counters[STAT_EVAL_TIMED_MISSES]){
+        return 0.0;
+    }
+
+    double probe_ns = (double)(int64_t)stats.counters[STAT_EVAL_PROBE_NS] / (int64_t)stats.counters[STAT_EVAL_TIMED_PROBES];
+    double eval_ns = (double)(int64_t)stats.counters[STAT_EVAL_MISS_NS] / (int64_t)stats.counters[STAT_EVAL_TIMED_MISSES];
+    return ((double)(int64_t)stats.counters[STAT_EVAL_HITS] * eval_ns - (double)(int64_t)stats.counters[STAT_EVAL_PROBES] * probe_ns) / 1e6;
+}
+
+// UCI score: centipawns, or moves to mate
+static std::string formatScore(int score){
+    if(std::abs(score) >= MATE_SCORE - MAX_PLY){
+        int plies = MATE_SCORE - std::abs(score);
+        int moves = (plies + 1) / 2;
+        return "mate " + std::to_string(score > 0 ? moves : -moves);
+    }
+    return "cp " + std::to_string(score);
+}
+
+std::string formatInfoUCI(int depth, int score, const SearchStats& stats, int elapsed_ms, double ebf, const std::vector<Move>& pv){
+    uint64_t nodes = stats.counters[STAT_NODES] + stats.counters[STAT_QNODES];
+
+    std::ostringstream out;
+    out << "info depth " << depth << " seldepth " << stats.seldepth
+        << " score " << formatScore(score)
+        << " nodes " << nodes
+        << " nps " << nodes * 1000 / std::max(1, elapsed_ms)
+        << " time " << elapsed_ms
+        << " tbhits " << stats.counters[STAT_TB_HITS]
+        << " pv";
+    char uci[UCI_MAX_LENGTH];
+    for(auto& move: pv){
+        move.writeUCI(uci);
+        out << " " << uci;
+    }
+
+#ifdef SEARCH_STATS
+    char ebf_text[32];
+    snprintf(ebf_text, sizeof(ebf_text), "%.2f", ebf);
+
+    out << "\ninfo string qnodes " << stats.counters[STAT_QNODES]
+        << " ebf " << ebf_text
+        << " tthits " << stats.counters[STAT_TT_HITS] << "/" << stats.counters[STAT_TT_PROBES]
+        << " ttcutoffs " << stats.counters[STAT_TT_CUTOFFS]
+        << " ttstores " << stats.counters[STAT_TT_STORES]
+        << " ttcollisions " << stats.counters[STAT_TT_COLLISIONS]
+        << " evalhits " << stats.counters[STAT_EVAL_HITS] << "/" << stats.counters[STAT_EVAL_PROBES]
+        << " evalsaved " << (int64_t)std::llround(evalCacheSavedMs(stats)) << "ms"
+        << " cutoffs " << stats.counters[STAT_BETA_CUTOFFS]
+        << " cutoffindex";
+    for(int i = 0; i < CUTOFF_SLOTS; i++){
+        out << " " << stats.counters[STAT_CUTOFF_INDEX + i];
+    }
+#else
+    (void)ebf;
+#endif
+
+    return out.str();
+}
+
+std::string formatInfoJSON(int depth, int score, const SearchStats& stats, int elapsed_ms, double ebf, const std::vector<Move>& pv){
+    uint64_t nodes = stats.counters[STAT_NODES] + stats.counters[STAT_QNODES];
+
+    std::ostringstream out;
+    out << "{\"depth\":" << depth
+        << ",\"seldepth\":" << stats.seldepth
+        << ",\"score\":" << score
+        << ",\"nodes\":" << stats.counters[STAT_NODES]
+        << ",\"qnodes\":" << stats.counters[STAT_QNODES]
+        << ",\"nps\":" << nodes * 1000 / std::max(1, elapsed_ms)
+        << ",\"time\":" << elapsed_ms
+        << ",\"tbhits\":" << stats.counters[STAT_TB_HITS]
+        << ",\"pv\":[";
+    char uci[UCI_MAX_LENGTH];
+    for(int i = 0; i < pv.size(); i++){
+        pv.at(i).writeUCI(uci);
+        out << (i ? "," : "") << "\"" << uci << "\"";
+    }
+    out << "]";
+
+#ifdef SEARCH_STATS
+    out << ",\"ebf\":" << ebf
+        << ",\"tt\":{\"probes\":" << stats.counters[STAT_TT_PROBES]
+        << ",\"hits\":" << stats.counters[STAT_TT_HITS]
+        << ",\"hit_rate\":" << hitRate(stats.counters[STAT_TT_HITS], stats.counters[STAT_TT_PROBES])
+        << ",\"cutoffs\":" << stats.counters[STAT_TT_CUTOFFS]
+        << ",\"stores\":" << stats.counters[STAT_TT_STORES]
+        << ",\"collisions\":" << stats.counters[STAT_TT_COLLISIONS] << "}"
+        << ",\"eval_cache\":{\"probes\":" << stats.counters[STAT_EVAL_PROBES]
+        << ",\"hits\":" << stats.counters[STAT_EVAL_HITS]
+        << ",\"hit_rate\":" << hitRate(stats.counters[STAT_EVAL_HITS], stats.counters[STAT_EVAL_PROBES])
+        << ",\"saved_ms\":" << evalCacheSavedMs(stats) << "}"
+        << ",\"beta_cutoffs\":" << stats.counters[STAT_BETA_CUTOFFS]
+        << ",\"cutoff_index\":[";
+    for(int i = 0; i < CUTOFF_SLOTS; i++){
+        out << (i ? "," : "") << stats.counters[STAT_CUTOFF_INDEX + i];
+    }
+    out << "]";
+#else
+    (void)ebf;
+#endif
+
+    out << "}";
+    return out.str();
+}
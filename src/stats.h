@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "move.h"
+
+// Beta cutoffs are counted by the index of the move that caused them,
+// moves after the last slot share it
+const int CUTOFF_SLOTS = 8;
+
+enum StatCounter{
+    STAT_NODES,
+    STAT_QNODES,
+    STAT_TT_PROBES,
+    STAT_TT_HITS,
+    STAT_TT_CUTOFFS,
+    STAT_TT_STORES,
+    STAT_TT_COLLISIONS,
+    STAT_EVAL_PROBES,
+    STAT_EVAL_HITS,
+    STAT_EVAL_TIMED_PROBES,
+    STAT_EVAL_PROBE_NS,
+    STAT_EVAL_TIMED_MISSES,
+    STAT_EVAL_MISS_NS,
+    STAT_TB_HITS,
+    STAT_BETA_CUTOFFS,
+    STAT_CUTOFF_INDEX,
+    STAT_COUNT = STAT_CUTOFF_INDEX + CUTOFF_SLOTS
+};
+
+// Totals over one or more search threads
+struct SearchStats{
+    uint64_t counters[STAT_COUNT] = {};
+    int seldepth = 0;
+
+    void add(const SearchStats& other);
+};
+
+// Counters of one search thread. Only the owning thread writes them, with
+// relaxed loads and stores that compile to plain moves, so the main thread
+// can read them while the search runs.
+struct ThreadStats{
+    std::atomic<uint64_t> counters[STAT_COUNT];
+    std::atomic<int> seldepth;
+
+    ThreadStats();
+
+    void clear();
+    SearchStats snapshot() const;
+};
+
+inline uint64_t statIncrement(ThreadStats& stats, StatCounter counter){
+    uint64_t value = stats.counters[counter].load(std::memory_order_relaxed) + 1;
+    stats.counters[counter].store(value, std::memory_order_relaxed);
+    return value;
+}
+
+inline void statAdd(ThreadStats& stats, StatCounter counter, uint64_t amount){
+    stats.counters[counter].store(stats.counters[counter].load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+inline void statMax(std::atomic<int>& stat, int value){
+    if(value > stat.load(std::memory_order_relaxed)){
+        stat.store(value, std::memory_order_relaxed);
+    }
+}
+
+// Detailed counters are compiled out unless SEARCH_STATS is defined; node
+// counts are always kept because the time checks depend on them, and
+// tablebase hits because UCI reports them
+#ifdef SEARCH_STATS
+#define STAT_INC(stats, counter) statIncrement(stats, counter)
+#define STAT_CUTOFF(stats, index) statIncrement(stats, (StatCounter)(STAT_CUTOFF_INDEX + std::min(index, CUTOFF_SLOTS - 1)))
+#else
+#define STAT_INC(stats, counter) ((void)0)
+#define STAT_CUTOFF(stats, index) ((void)0)
+#endif
+
+// Evaluation time the eval cache saved, from the sampled cost of an
+// evaluation and of a cache lookup; negative when the cache does not pay
+double evalCacheSavedMs(const SearchStats& stats);
+
+// One line per completed iteration, as UCI info lines or a JSON object.
+// ebf is the node count of this iteration over the one before.
+std::string formatInfoUCI(int depth, int score, const SearchStats& stats, int elapsed_ms, double ebf, const std::vector<Move>& pv);
+std::string formatInfoJSON(int depth, int score, const SearchStats& stats, int elapsed_ms, double ebf, const std::vector<Move>& pv);
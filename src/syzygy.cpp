@@ -0,0 +1,1114 @@
+#include "syzygy.h"
+#include "board.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Probing follows the Syzygy file format: positions are mapped to an index
+// by symmetry and piece grouping, and each table is a sequence of blocks
+// compressed with a canonical Huffman code over recursively paired symbols.
+
+const int TB_PIECES = 7;
+
+const uint8_t WDL_MAGIC[4] = {0x71, 0xE8, 0x23, 0x5D};
+const uint8_t DTZ_MAGIC[4] = {0xD7, 0x66, 0x0C, 0xA5};
+
+const uint8_t TB_FLAG_STM = 1;
+const uint8_t TB_FLAG_MAPPED = 2;
+const uint8_t TB_FLAG_WIN_PLIES = 4;
+const uint8_t TB_FLAG_LOSS_PLIES = 8;
+const uint8_t TB_FLAG_WIDE = 16;
+const uint8_t TB_FLAG_SINGLE_VALUE = 128;
+
+// Outcome of probing one table
+const int PROBE_FAIL = 0;
+const int PROBE_OK = 1;
+const int PROBE_CHANGE_STM = -1;
+const int PROBE_ZEROING_BEST_MOVE = 2;
+
+inline uint16_t readLE16(const uint8_t* p){
+    return p[0] | (p[1] << 8);
+}
+
+inline uint32_t readLE32(const uint8_t* p){
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline uint32_t readBE32(const uint8_t* p){
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+inline uint64_t readBE64(const uint8_t* p){
+    return ((uint64_t)readBE32(p) << 32) | readBE32(p + 4);
+}
+
+// Tables number the colors the other way round: white 0, black 1. A piece
+// is its type with the color in bit 3.
+inline int tbColor(Color color){
+    return color == WHITE ? 0 : 1;
+}
+
+inline int offA1H8(int square){
+    return (square >> 3) - (square & 7);
+}
+
+// Index tables shared by all tables of the format
+struct TBIndexTables{
+    int map_a1d1d4[64];
+    int map_b1h1h7[64];
+    int map_kk[10][64];
+    int map_pawns[64];
+    int lead_pawn_index[6][64];
+    int lead_pawns_size[6][4];
+    uint64_t binomial[7][64];
+
+    TBIndexTables(){
+        std::fill(&map_a1d1d4[0], &map_a1d1d4[0] + 64, 0);
+        std::fill(&map_b1h1h7[0], &map_b1h1h7[0] + 64, 0);
+        std::fill(&map_kk[0][0], &map_kk[0][0] + 10 * 64, 0);
+        std::fill(&map_pawns[0], &map_pawns[0] + 64, 0);
+        std::fill(&lead_pawn_index[0][0], &lead_pawn_index[0][0] + 6 * 64, 0);
+        std::fill(&lead_pawns_size[0][0], &lead_pawns_size[0][0] + 6 * 4, 0);
+        std::fill(&binomial[0][0], &binomial[0][0] + 7 * 64, 0);
+
+        // squares below the a1-h8 diagonal to 0..27
+        int code = 0;
+        for(int square = 0; square < 64; square++){
+            if(offA1H8(square) < 0){
+                map_b1h1h7[square] = code++;
+            }
+        }
+
+        // the a1-d1-d4 triangle to 0..9, diagonal squares last
+        std::vector<int> diagonal;
+        code = 0;
+        for(int square = A1; square <= D4; square++){
+            if(offA1H8(square) < 0 && (square & 7) <= 3){
+                map_a1d1d4[square] = code++;
+            } else if (!offA1H8(square) && (square & 7) <= 3){
+                diagonal.push_back(square);
+            }
+        }
+        for(int square: diagonal){
+            map_a1d1d4[square] = code++;
+        }
+
+        // the 462 legal placements of two kings with the first in the
+        // triangle; with the first on the diagonal the second is not above
+        // it, and placements with both on the diagonal come last
+        std::vector<std::pair<int, int>> both_on_diagonal;
+        code = 0;
+        for(int index = 0; index < 10; index++){
+            for(int s1 = A1; s1 <= D4; s1++){
+                if(map_a1d1d4[s1] != index || (!index && s1 != B1)){
+                    continue;
+                }
+
+                for(int s2 = 0; s2 < 64; s2++){
+                    if(std::max(std::abs((s1 >> 3) - (s2 >> 3)), std::abs((s1 & 7) - (s2 & 7))) <= 1){
+                        continue;
+                    } else if (!offA1H8(s1) && offA1H8(s2) > 0){
+                        continue;
+                    } else if (!offA1H8(s1) && !offA1H8(s2)){
+                        both_on_diagonal.push_back(std::make_pair(index, s2));
+                    } else {
+                        map_kk[index][s2] = code++;
+                    }
+                }
+            }
+        }
+        for(auto& placement: both_on_diagonal){
+            map_kk[placement.first][placement.second] = code++;
+        }
+
+        binomial[0][0] = 1;
+        for(int n = 1; n < 64; n++){
+            for(int k = 0; k < 7 && k <= n; k++){
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+            }
+        }
+
+        // a2-h7 to 47..0: the squares left for other pawns when the leading
+        // pawn, the one nearest the edge and lowest, stands there
+        int available = 47;
+        for(int lead_pawns = 1; lead_pawns <= 5; lead_pawns++){
+            for(int file = 0; file < 4; file++){
+                int index = 0;
+                for(int rank = 1; rank <= 6; rank++){
+                    int square = rank * 8 + file;
+                    if(lead_pawns == 1){
+                        map_pawns[square] = available--;
+                        map_pawns[square ^ 7] = available--;
+                    }
+                    lead_pawn_index[lead_pawns][square] = index;
+                    index += binomial[lead_pawns - 1][map_pawns[square]];
+                }
+                lead_pawns_size[lead_pawns][file] = index;
+            }
+        }
+    }
+};
+
+const TBIndexTables TB_INDEX;
+
+// One compressed sub-table: a side to move and, with pawns, a file of the
+// leading pawn
+struct PairsData{
+    uint8_t flags;
+    int max_sym_len;
+    int min_sym_len;
+    uint32_t num_blocks;
+    size_t block_size;
+    size_t span;
+
+    const uint8_t* lowest_sym;
+    const uint8_t* btree;
+    const uint8_t* block_length;
+    uint32_t block_length_size;
+    const uint8_t* sparse_index;
+    size_t sparse_index_size;
+    const uint8_t* data;
+
+    std::vector<uint64_t> base64;
+    std::vector<uint8_t> symlen;
+
+    uint8_t pieces[TB_PIECES];
+    uint64_t group_index[TB_PIECES + 1];
+    int group_length[TB_PIECES + 1];
+
+    // DTZ only: start of the value map of each WDL outcome
+    uint16_t map_index[4];
+
+    int left(int sym) const{
+        return ((btree[3 * sym + 1] & 0xF) << 8) | btree[3 * sym];
+    }
+
+    int right(int sym) const{
+        return (btree[3 * sym + 2] << 4) | (btree[3 * sym + 1] >> 4);
+    }
+};
+
+struct TBTable{
+    bool dtz;
+
+    // material keys with the stronger side, the first in the file name, as
+    // white and as black
+    uint64_t key;
+    uint64_t key2;
+
+    int piece_count;
+    bool has_pawns;
+    bool has_unique_pieces;
+
+    // pawns of the leading color first
+    int pawn_count[2];
+    int sides;
+
+    void* mapping;
+    size_t mapping_size;
+
+    // DTZ only: value maps of all sub-tables
+    const uint8_t* map;
+
+    PairsData items[2][4];
+
+    TBTable(){
+        mapping = nullptr;
+        mapping_size = 0;
+        map = nullptr;
+    }
+
+    ~TBTable(){
+#if defined(__unix__) || defined(__APPLE__)
+        if(mapping){
+            munmap(mapping, mapping_size);
+        }
+#endif
+    }
+
+    PairsData* get(int stm, int file){
+        return &items[stm % sides][has_pawns ? file : 0];
+    }
+};
+
+// Piece counts packed four bits each, white (the table's color 0) first
+uint64_t materialKey(const int counts[2][7]){
+    uint64_t key = 0;
+    for(int color = 0; color < 2; color++){
+        for(int piecetype = PAWN; piecetype <= QUEEN; piecetype++){
+            key |= (uint64_t)counts[color][piecetype] << (4 * (piecetype - PAWN) + 20 * color);
+        }
+    }
+    return key;
+}
+
+uint64_t materialKey(const Board& b){
+    int counts[2][7] = {};
+    BitBoard masks[7] = {0, b.pawns, b.knights, b.bishops, b.rooks, b.queens, b.kings};
+    for(int piecetype = PAWN; piecetype <= QUEEN; piecetype++){
+        counts[0][piecetype] = popcount(masks[piecetype] & b.occupied_color[WHITE]);
+        counts[1][piecetype] = popcount(masks[piecetype] & b.occupied_color[BLACK]);
+    }
+    return materialKey(counts);
+}
+
+std::vector<std::unique_ptr<TBTable>> tb_tables;
+std::unordered_map<uint64_t, TBTable*> wdl_tables;
+std::unordered_map<uint64_t, TBTable*> dtz_tables;
+int tb_largest = 0;
+
+int symbolLength(PairsData* d, int sym, std::vector<bool>& visited){
+    visited[sym] = true;
+
+    int right = d->right(sym);
+    if(right == 0xFFF){
+        return 0;
+    }
+
+    int left = d->left(sym);
+    if(!visited[left]){
+        d->symlen[left] = symbolLength(d, left, visited);
+    }
+    if(!visited[right]){
+        d->symlen[right] = symbolLength(d, right, visited);
+    }
+    return d->symlen[left] + d->symlen[right] + 1;
+}
+
+// Whether n bytes from data lie before the end of the mapping
+inline bool fits(const uint8_t* data, size_t n, const uint8_t* end){
+    return data <= end && n <= (size_t)(end - data);
+}
+
+// Reads the sizes and Huffman code of one sub-table, returns the data after
+// it or nullptr when they do not fit in the file
+const uint8_t* setSizes(PairsData* d, const uint8_t* data, const uint8_t* end){
+    if(!fits(data, 2, end)){
+        return nullptr;
+    }
+    d->flags = *data++;
+
+    if(d->flags & TB_FLAG_SINGLE_VALUE){
+        d->num_blocks = 0;
+        d->block_size = 0;
+        d->span = 0;
+        d->block_length_size = 0;
+        d->sparse_index_size = 0;
+        d->min_sym_len = *data++;
+        return data;
+    }
+
+    int groups = std::find(d->group_length, d->group_length + TB_PIECES, 0) - d->group_length;
+    uint64_t table_size = d->group_index[groups];
+
+    if(!fits(data, 9, end) || data[0] >= 32 || data[1] >= 32){
+        return nullptr;
+    }
+    d->block_size = (size_t)1 << *data++;
+    d->span = (size_t)1 << *data++;
+    d->sparse_index_size = (table_size + d->span - 1) / d->span;
+    int padding = *data++;
+    d->num_blocks = readLE32(data);
+    data += 4;
+    d->block_length_size = d->num_blocks + padding;
+    d->max_sym_len = *data++;
+    d->min_sym_len = *data++;
+    d->lowest_sym = data;
+
+    // codes are 1 to 64 bits long
+    if(d->min_sym_len < 1 || d->max_sym_len < d->min_sym_len || d->max_sym_len > 64 ||
+       !fits(data, (d->max_sym_len - d->min_sym_len + 1) * 2 + 2, end)){
+        return nullptr;
+    }
+
+    // base64[i] is the lowest code of length min_sym_len + i, left aligned
+    // in 64 bits; longer codes have lower values
+    d->base64.assign(d->max_sym_len - d->min_sym_len + 1, 0);
+    for(int i = (int)d->base64.size() - 2; i >= 0; i--){
+        d->base64[i] = (d->base64[i + 1] + readLE16(d->lowest_sym + 2 * i) - readLE16(d->lowest_sym + 2 * (i + 1))) / 2;
+    }
+    for(size_t i = 0; i < d->base64.size(); i++){
+        d->base64[i] <<= 64 - i - d->min_sym_len;
+    }
+    data += d->base64.size() * 2;
+
+    d->symlen.assign(readLE16(data), 0);
+    data += 2;
+    d->btree = data;
+
+    // every pair must be made of symbols of the tree
+    if(!fits(data, d->symlen.size() * 3 + (d->symlen.size() & 1), end)){
+        return nullptr;
+    }
+    for(size_t sym = 0; sym < d->symlen.size(); sym++){
+        if(d->right(sym) != 0xFFF && (d->left(sym) >= (int)d->symlen.size() || d->right(sym) >= (int)d->symlen.size())){
+            return nullptr;
+        }
+    }
+
+    std::vector<bool> visited(d->symlen.size(), false);
+    for(size_t sym = 0; sym < d->symlen.size(); sym++){
+        if(!visited[sym]){
+            d->symlen[sym] = symbolLength(d, sym, visited);
+        }
+    }
+
+    return data + d->symlen.size() * 3 + (d->symlen.size() & 1);
+}
+
+// Value stored at index idx of a sub-table
+int decompressPairs(const PairsData* d, uint64_t idx){
+    if(d->flags & TB_FLAG_SINGLE_VALUE){
+        return d->min_sym_len;
+    }
+
+    // the sparse index points near the block holding idx
+    uint32_t k = idx / d->span;
+    uint32_t block = readLE32(d->sparse_index + 6 * k);
+    int offset = readLE16(d->sparse_index + 6 * k + 4);
+
+    offset += (int)(idx % d->span) - (int)(d->span / 2);
+
+    while(offset < 0){
+        offset += readLE16(d->block_length + 2 * --block) + 1;
+    }
+    while(offset > readLE16(d->block_length + 2 * block)){
+        offset -= readLE16(d->block_length + 2 * block++) + 1;
+    }
+
+    const uint8_t* ptr = d->data + (uint64_t)block * d->block_size;
+    uint64_t buffer = readBE64(ptr);
+    ptr += 8;
+    int buffer_bits = 64;
+
+    // walk the symbols of the block until the one covering offset
+    int sym;
+    while(true){
+        int length = 0;
+        while(buffer < d->base64[length]){
+            length++;
+        }
+        sym = (int)((buffer - d->base64[length]) >> (64 - length - d->min_sym_len));
+        sym += readLE16(d->lowest_sym + 2 * length);
+
+        if(offset < d->symlen[sym] + 1){
+            break;
+        }
+        offset -= d->symlen[sym] + 1;
+
+        length += d->min_sym_len;
+        buffer <<= length;
+        buffer_bits -= length;
+        if(buffer_bits <= 32){
+            buffer_bits += 32;
+            buffer |= (uint64_t)readBE32(ptr) << (64 - buffer_bits);
+            ptr += 4;
+        }
+    }
+
+    // then expand the pairs down to the single value at offset
+    while(d->symlen[sym]){
+        int left = d->left(sym);
+        if(offset < d->symlen[left] + 1){
+            sym = left;
+        } else {
+            offset -= d->symlen[left] + 1;
+            sym = d->right(sym);
+        }
+    }
+    return d->left(sym);
+}
+
+// Order and sizes of the piece groups the index is built from
+void setGroups(const TBTable& e, PairsData* d, const int order[2], int file){
+    int n = 0;
+    int first_length = e.has_pawns ? 0 : e.has_unique_pieces ? 3 : 2;
+    d->group_length[n] = 1;
+
+    for(int i = 1; i < e.piece_count; i++){
+        if(--first_length > 0 || d->pieces[i] == d->pieces[i - 1]){
+            d->group_length[n]++;
+        } else {
+            d->group_length[++n] = 1;
+        }
+    }
+    d->group_length[++n] = 0;
+
+    bool pawns_both_sides = e.has_pawns && e.pawn_count[1];
+    int next = pawns_both_sides ? 2 : 1;
+    int free_squares = 64 - d->group_length[0] - (pawns_both_sides ? d->group_length[1] : 0);
+    uint64_t idx = 1;
+
+    for(int k = 0; next < n || k == order[0] || k == order[1]; k++){
+        if(k == order[0]){
+            d->group_index[0] = idx;
+            idx *= e.has_pawns ? TB_INDEX.lead_pawns_size[d->group_length[0]][file] : e.has_unique_pieces ? 31332 : 462;
+        } else if (k == order[1]){
+            d->group_index[1] = idx;
+            idx *= TB_INDEX.binomial[d->group_length[1]][48 - d->group_length[0]];
+        } else {
+            d->group_index[next] = idx;
+            idx *= TB_INDEX.binomial[d->group_length[next]][free_squares];
+            free_squares -= d->group_length[next++];
+        }
+    }
+    d->group_index[n] = idx;
+}
+
+// Value maps of the DTZ sub-tables, returns the data after them or nullptr
+// when they do not fit in the file
+const uint8_t* setDTZMap(TBTable& e, const uint8_t* data, const uint8_t* end, int max_file){
+    e.map = data;
+
+    for(int file = 0; file <= max_file; file++){
+        PairsData* d = e.get(0, file);
+        if(!(d->flags & TB_FLAG_MAPPED)){
+            continue;
+        }
+
+        if(d->flags & TB_FLAG_WIDE){
+            data += (uintptr_t)data & 1;
+            for(int i = 0; i < 4; i++){
+                if(!fits(data, 2, end)){
+                    return nullptr;
+                }
+                d->map_index[i] = (data - e.map) / 2 + 1;
+                data += 2 * readLE16(data) + 2;
+            }
+        } else {
+            for(int i = 0; i < 4; i++){
+                if(!fits(data, 1, end)){
+                    return nullptr;
+                }
+                d->map_index[i] = data - e.map + 1;
+                data += *data + 1;
+            }
+        }
+    }
+    data += (uintptr_t)data & 1;
+    return fits(data, 0, end) ? data : nullptr;
+}
+
+// Sets up the sub-tables from the header at data, false when the file ends
+// before the sizes it gives; the data blocks start on a 64 byte boundary and
+// only a checksum follows them
+bool initTable(TBTable& e, const uint8_t* data, const uint8_t* end){
+    int max_file = e.has_pawns ? 3 : 0;
+    bool pawns_both_sides = e.has_pawns && e.pawn_count[1];
+
+    if(!fits(data, 1 + (max_file + 1) * (1 + pawns_both_sides + e.piece_count), end)){
+        return false;
+    }
+    data++;
+
+    for(int file = 0; file <= max_file; file++){
+        int order[2][2] = {{*data & 0xF, pawns_both_sides ? *(data + 1) & 0xF : 0xF},
+                           {*data >> 4, pawns_both_sides ? *(data + 1) >> 4 : 0xF}};
+        data += 1 + pawns_both_sides;
+
+        for(int k = 0; k < e.piece_count; k++, data++){
+            for(int i = 0; i < e.sides; i++){
+                e.get(i, file)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+            }
+        }
+
+        for(int i = 0; i < e.sides; i++){
+            setGroups(e, e.get(i, file), order[i], file);
+        }
+    }
+
+    data += (uintptr_t)data & 1;
+
+    for(int file = 0; file <= max_file; file++){
+        for(int i = 0; i < e.sides; i++){
+            data = setSizes(e.get(i, file), data, end);
+            if(!data){
+                return false;
+            }
+        }
+    }
+
+    if(e.dtz){
+        data = setDTZMap(e, data, end, max_file);
+        if(!data){
+            return false;
+        }
+    }
+
+    for(int file = 0; file <= max_file; file++){
+        for(int i = 0; i < e.sides; i++){
+            e.get(i, file)->sparse_index = data;
+            if(!fits(data, e.get(i, file)->sparse_index_size * 6, end)){
+                return false;
+            }
+            data += e.get(i, file)->sparse_index_size * 6;
+        }
+    }
+
+    for(int file = 0; file <= max_file; file++){
+        for(int i = 0; i < e.sides; i++){
+            e.get(i, file)->block_length = data;
+            if(!fits(data, e.get(i, file)->block_length_size * 2, end)){
+                return false;
+            }
+            data += e.get(i, file)->block_length_size * 2;
+        }
+    }
+
+    for(int file = 0; file <= max_file; file++){
+        for(int i = 0; i < e.sides; i++){
+            data = (const uint8_t*)(((uintptr_t)data + 0x3F) & ~(uintptr_t)0x3F);
+            e.get(i, file)->data = data;
+            if(!fits(data, (size_t)e.get(i, file)->num_blocks * e.get(i, file)->block_size, end)){
+                return false;
+            }
+            data += (size_t)e.get(i, file)->num_blocks * e.get(i, file)->block_size;
+        }
+    }
+    return true;
+}
+
+// Maps one table file named after its material, like KRPvKR.rtbw
+bool mapTable(const std::string& directory, const std::string& name, bool dtz){
+#if defined(__unix__) || defined(__APPLE__)
+    size_t separator = name.find('v');
+    if(separator == std::string::npos || name.empty() || name[0] != 'K'){
+        return false;
+    }
+
+    const std::string piece_chars = " PNBRQK";
+    int counts[2][7] = {};
+    int piece_count = 0;
+    for(size_t i = 0; i < name.size(); i++){
+        if(i == separator){
+            continue;
+        }
+        size_t piecetype = piece_chars.find(name[i]);
+        if(piecetype == std::string::npos || piecetype == 0){
+            return false;
+        }
+        counts[i > separator][piecetype]++;
+        piece_count++;
+    }
+    if(piece_count > TB_PIECES || counts[0][KING] != 1 || counts[1][KING] != 1){
+        return false;
+    }
+
+    std::string path = directory + "/" + name + (dtz ? ".rtbz" : ".rtbw");
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size % 64 != 16){
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        return false;
+    }
+
+    std::unique_ptr<TBTable> table(new TBTable());
+    table->mapping = mapping;
+    table->mapping_size = st.st_size;
+
+    const uint8_t* data = (const uint8_t*)mapping;
+    if(std::memcmp(data, dtz ? DTZ_MAGIC : WDL_MAGIC, 4) != 0){
+        return false;
+    }
+
+    int swapped[2][7];
+    std::copy(&counts[0][0], &counts[0][0] + 7, &swapped[1][0]);
+    std::copy(&counts[1][0], &counts[1][0] + 7, &swapped[0][0]);
+
+    table->dtz = dtz;
+    table->key = materialKey(counts);
+    table->key2 = materialKey(swapped);
+    table->piece_count = piece_count;
+    table->has_pawns = counts[0][PAWN] || counts[1][PAWN];
+    table->has_unique_pieces = false;
+    for(int color = 0; color < 2; color++){
+        for(int piecetype = PAWN; piecetype <= QUEEN; piecetype++){
+            if(counts[color][piecetype] == 1){
+                table->has_unique_pieces = true;
+            }
+        }
+    }
+
+    // with pawns on both sides the side with fewer pawns leads
+    bool white_leads = !counts[1][PAWN] || (counts[0][PAWN] && counts[1][PAWN] >= counts[0][PAWN]);
+    table->pawn_count[0] = counts[white_leads ? 0 : 1][PAWN];
+    table->pawn_count[1] = counts[white_leads ? 1 : 0][PAWN];
+    table->sides = (!dtz && table->key != table->key2) ? 2 : 1;
+
+    if(!initTable(*table, data + 4, data + table->mapping_size)){
+        std::cerr << "Rejected " << path << ": the file ends before the data its header describes" << std::endl;
+        return false;
+    }
+
+    auto& tables = dtz ? dtz_tables : wdl_tables;
+    tables[table->key] = table.get();
+    tables[table->key2] = table.get();
+    if(!dtz){
+        tb_largest = std::max(tb_largest, piece_count);
+    }
+    tb_tables.push_back(std::move(table));
+    return true;
+#else
+    return false;
+#endif
+}
+
+int initTablebases(const std::string& paths){
+    wdl_tables.clear();
+    dtz_tables.clear();
+    tb_tables.clear();
+    tb_largest = 0;
+
+    int found = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    size_t start = 0;
+    while(start <= paths.size()){
+        size_t end = paths.find(':', start);
+        if(end == std::string::npos){
+            end = paths.size();
+        }
+        std::string directory = paths.substr(start, end - start);
+        start = end + 1;
+
+        DIR* dir = directory.empty() ? nullptr : opendir(directory.c_str());
+        if(!dir){
+            continue;
+        }
+
+        while(dirent* entry = readdir(dir)){
+            std::string file = entry->d_name;
+            if(file.size() < 5){
+                continue;
+            }
+
+            std::string extension = file.substr(file.size() - 5);
+            std::string name = file.substr(0, file.size() - 5);
+            if(extension == ".rtbw" && mapTable(directory, name, false)){
+                found++;
+            } else if (extension == ".rtbz"){
+                mapTable(directory, name, true);
+            }
+        }
+        closedir(dir);
+    }
+#endif
+    return found;
+}
+
+int tablebaseLargest(){
+    return tb_largest;
+}
+
+inline bool pawnsBefore(int a, int b){
+    return TB_INDEX.map_pawns[a] < TB_INDEX.map_pawns[b];
+}
+
+bool checkDTZSide(TBTable* entry, int stm, int file){
+    if(!entry->dtz){
+        return true;
+    }
+    int flags = entry->get(stm, file)->flags;
+    return (flags & TB_FLAG_STM) == stm || (entry->key == entry->key2 && !entry->has_pawns);
+}
+
+int mapScore(TBTable* entry, int file, int value, int wdl){
+    if(!entry->dtz){
+        return value - 2;
+    }
+
+    const int wdl_map[5] = {1, 3, 0, 2, 0};
+    PairsData* d = entry->get(0, file);
+
+    if(d->flags & TB_FLAG_MAPPED){
+        if(d->flags & TB_FLAG_WIDE){
+            value = readLE16(entry->map + 2 * (d->map_index[wdl_map[wdl + 2]] + value));
+        } else {
+            value = entry->map[d->map_index[wdl_map[wdl + 2]] + value];
+        }
+    }
+
+    // stored in moves unless the flags say plies
+    if((wdl == TB_WIN && !(d->flags & TB_FLAG_WIN_PLIES)) || (wdl == TB_LOSS && !(d->flags & TB_FLAG_LOSS_PLIES)) ||
+       wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS){
+        value *= 2;
+    }
+    return value + 1;
+}
+
+// WDL (value - 2) or DTZ of the position as stored in one table
+int probeTable(Board& b, bool dtz, int wdl, int& state){
+    if(popcount(b.occupied) == 2){
+        state = PROBE_OK;
+        return dtz ? 0 : TB_DRAW;
+    }
+
+    auto& tables = dtz ? dtz_tables : wdl_tables;
+    auto found = tables.find(materialKey(b));
+    if(found == tables.end()){
+        state = PROBE_FAIL;
+        return 0;
+    }
+    TBTable* entry = found->second;
+
+    // tables store the stronger side as white, and with equal material
+    // only white to move, so the board is mirrored when needed
+    bool symmetric_black_to_move = entry->key == entry->key2 && b.turn == BLACK;
+    bool black_stronger = materialKey(b) != entry->key;
+    bool flip = symmetric_black_to_move || black_stronger;
+
+    int flip_color = flip ? 8 : 0;
+    int flip_squares = flip ? 56 : 0;
+    int stm = (int)flip ^ tbColor(b.turn);
+
+    int squares[TB_PIECES];
+    int pieces[TB_PIECES];
+    int size = 0;
+    int lead_pawns_count = 0;
+    BitBoard lead_pawns = 0;
+    int tb_file = 0;
+
+    if(entry->has_pawns){
+        int lead = entry->get(0, 0)->pieces[0] ^ flip_color;
+        Color lead_color = (lead >> 3) ? BLACK : WHITE;
+
+        lead_pawns = b.pawns & b.occupied_color[lead_color];
+        BitBoard bb = lead_pawns;
+        while(bb){
+            squares[size++] = lsb(bb) ^ flip_squares;
+            bb &= bb - 1;
+        }
+        lead_pawns_count = size;
+
+        std::swap(squares[0], *std::max_element(squares, squares + lead_pawns_count, pawnsBefore));
+
+        int file = squares[0] & 7;
+        tb_file = std::min(file, 7 - file);
+    }
+
+    if(!checkDTZSide(entry, stm, tb_file)){
+        state = PROBE_CHANGE_STM;
+        return 0;
+    }
+
+    BitBoard bb = b.occupied ^ lead_pawns;
+    while(bb){
+        Square square = lsb(bb);
+        squares[size] = square ^ flip_squares;
+        pieces[size++] = (b.pieceTypeAt(square) | (tbColor(b.colorAt(square)) << 3)) ^ flip_color;
+        bb &= bb - 1;
+    }
+
+    PairsData* d = entry->get(stm, tb_file);
+
+    // same piece order as the table
+    for(int i = lead_pawns_count; i < size - 1; i++){
+        for(int j = i + 1; j < size; j++){
+            if(d->pieces[i] == pieces[j]){
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // leading piece into the a1-d1-d4 triangle (or files a-d with pawns)
+    if((squares[0] & 7) > 3){
+        for(int i = 0; i < size; i++){
+            squares[i] ^= 7;
+        }
+    }
+
+    uint64_t idx;
+    if(entry->has_pawns){
+        idx = TB_INDEX.lead_pawn_index[lead_pawns_count][squares[0]];
+
+        std::stable_sort(squares + 1, squares + lead_pawns_count, pawnsBefore);
+        for(int i = 1; i < lead_pawns_count; i++){
+            idx += TB_INDEX.binomial[i][TB_INDEX.map_pawns[squares[i]]];
+        }
+    } else {
+        if((squares[0] >> 3) > 3){
+            for(int i = 0; i < size; i++){
+                squares[i] ^= 56;
+            }
+        }
+
+        // first piece of the leading group off the diagonal goes below it
+        for(int i = 0; i < d->group_length[0]; i++){
+            if(!offA1H8(squares[i])){
+                continue;
+            }
+            if(offA1H8(squares[i]) > 0){
+                for(int j = i; j < size; j++){
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                }
+            }
+            break;
+        }
+
+        if(entry->has_unique_pieces){
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if(offA1H8(squares[0])){
+                idx = ((uint64_t)TB_INDEX.map_a1d1d4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            } else if (offA1H8(squares[1])){
+                idx = (6 * 63 + (squares[0] >> 3) * 28 + TB_INDEX.map_b1h1h7[squares[1]]) * 62 + squares[2] - adjust2;
+            } else if (offA1H8(squares[2])){
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + (squares[0] >> 3) * 7 * 28 + ((squares[1] >> 3) - adjust1) * 28 +
+                      TB_INDEX.map_b1h1h7[squares[2]];
+            } else {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (squares[0] >> 3) * 7 * 6 + ((squares[1] >> 3) - adjust1) * 6 +
+                      ((squares[2] >> 3) - adjust2);
+            }
+        } else {
+            idx = TB_INDEX.map_kk[TB_INDEX.map_a1d1d4[squares[0]]][squares[1]];
+        }
+    }
+
+    // remaining groups, each as a combination of the squares left over
+    idx *= d->group_index[0];
+    int* group_squares = squares + d->group_length[0];
+    bool remaining_pawns = entry->has_pawns && entry->pawn_count[1];
+
+    int next = 0;
+    while(d->group_length[++next]){
+        std::stable_sort(group_squares, group_squares + d->group_length[next]);
+
+        uint64_t n = 0;
+        for(int i = 0; i < d->group_length[next]; i++){
+            int adjust = std::count_if(squares, group_squares, [&](int square){ return group_squares[i] > square; });
+            n += TB_INDEX.binomial[i + 1][group_squares[i] - adjust - 8 * remaining_pawns];
+        }
+
+        remaining_pawns = false;
+        idx += n * d->group_index[next];
+        group_squares += d->group_length[next];
+    }
+
+    state = PROBE_OK;
+    return mapScore(entry, tb_file, decompressPairs(d, idx), wdl);
+}
+
+// WDL after searching the captures (and with check_zeroing the pawn moves)
+// first: tables hold "don't care" values where a capture is best and
+// know nothing about en passant
+int searchWDL(Board& b, bool check_zeroing, int& state){
+    int best = TB_LOSS;
+    std::vector<Move> moves = b.generateLegalMoves();
+    size_t searched = 0;
+
+    for(auto& move: moves){
+        if(!b.isCapture(move) && (!check_zeroing || b.pieceTypeAt(move.from_square) != PAWN)){
+            continue;
+        }
+        searched++;
+
+        b.push(move);
+        int value = -searchWDL(b, false, state);
+        b.pop();
+
+        if(state == PROBE_FAIL){
+            return TB_DRAW;
+        }
+
+        if(value > best){
+            best = value;
+            if(value >= TB_WIN){
+                state = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    bool no_more_moves = searched && searched == moves.size();
+
+    int value;
+    if(no_more_moves){
+        value = best;
+    } else {
+        value = probeTable(b, false, TB_DRAW, state);
+        if(state == PROBE_FAIL){
+            return TB_DRAW;
+        }
+    }
+
+    if(best >= value){
+        state = (best > TB_DRAW || no_more_moves) ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+        return best;
+    }
+
+    state = PROBE_OK;
+    return value;
+}
+
+bool probeWDL(Board& b, int& wdl){
+    int state = PROBE_OK;
+    wdl = searchWDL(b, false, state);
+    return state != PROBE_FAIL;
+}
+
+int dtzBeforeZeroing(int wdl){
+    return wdl == TB_WIN ? 1 : wdl == TB_CURSED_WIN ? 101 : wdl == TB_BLESSED_LOSS ? -101 : wdl == TB_LOSS ? -1 : 0;
+}
+
+inline int sign(int value){
+    return (value > 0) - (value < 0);
+}
+
+int searchDTZ(Board& b, int& state){
+    state = PROBE_OK;
+    int wdl = searchWDL(b, true, state);
+
+    if(state == PROBE_FAIL || wdl == TB_DRAW){
+        return 0;
+    }
+
+    if(state == PROBE_ZEROING_BEST_MOVE){
+        return dtzBeforeZeroing(wdl);
+    }
+
+    int dtz = probeTable(b, true, wdl, state);
+    if(state == PROBE_FAIL){
+        return 0;
+    }
+
+    if(state != PROBE_CHANGE_STM){
+        return (dtz + 100 * (wdl == TB_BLESSED_LOSS || wdl == TB_CURSED_WIN)) * sign(wdl);
+    }
+
+    // the table holds the other side to move: take the best reply's DTZ
+    int min_dtz = 0xFFFF;
+    for(auto& move: b.generateLegalMoves()){
+        bool zeroing = b.isCapture(move) || b.pieceTypeAt(move.from_square) == PAWN;
+
+        b.push(move);
+        if(zeroing){
+            dtz = -dtzBeforeZeroing(searchWDL(b, false, state));
+        } else {
+            dtz = -searchDTZ(b, state);
+        }
+
+        if(dtz == 1 && b.isCheckmate()){
+            min_dtz = 1;
+        }
+        if(!zeroing){
+            dtz += sign(dtz);
+        }
+        if(dtz < min_dtz && sign(dtz) == sign(wdl)){
+            min_dtz = dtz;
+        }
+        b.pop();
+
+        if(state == PROBE_FAIL){
+            return 0;
+        }
+    }
+
+    return min_dtz == 0xFFFF ? -1 : min_dtz;
+}
+
+bool probeDTZ(Board& b, int& dtz){
+    int state = PROBE_OK;
+    dtz = searchDTZ(b, state);
+    return state != PROBE_FAIL;
+}
+
+// Better moves rank higher: wins within the fifty move rule by fewest
+// plies to zeroing, then cursed wins, draws, blessed losses and losses
+int rankDTZ(int dtz, int halfmove_clock){
+    if(dtz > 0){
+        return (dtz + halfmove_clock <= 99) ? 20000 - dtz : 10000 - dtz;
+    }
+    if(dtz < 0){
+        return (-dtz * 2 + halfmove_clock < 100) ? -20000 - dtz : -10000 - dtz;
+    }
+    return 0;
+}
+
+bool filterRootMoves(Board& b, std::vector<Move>& moves){
+    if(!tb_largest || b.castling_rights || popcount(b.occupied) > tb_largest || moves.empty()){
+        return false;
+    }
+
+    std::vector<int> ranks;
+    bool use_dtz = true;
+    for(auto& move: moves){
+        b.push(move);
+
+        int dtz;
+        bool ok;
+        if(b.isRepetition()){
+            // a threefold repetition in the game is a draw whatever the
+            // tables say
+            ok = true;
+            dtz = 0;
+        } else if (b.halfmove_clock == 0){
+            int wdl;
+            ok = probeWDL(b, wdl);
+            dtz = dtzBeforeZeroing(-wdl);
+        } else {
+            ok = probeDTZ(b, dtz);
+            dtz = -dtz;
+            dtz += sign(dtz);
+        }
+
+        // a mating move is one ply from zeroing
+        if(ok && dtz == 2 && b.isCheckmate()){
+            dtz = 1;
+        }
+        b.pop();
+
+        if(!ok){
+            use_dtz = false;
+            break;
+        }
+        ranks.push_back(rankDTZ(dtz, b.halfmove_clock));
+    }
+
+    if(!use_dtz){
+        ranks.clear();
+        for(auto& move: moves){
+            b.push(move);
+            int wdl = TB_DRAW;
+            bool ok = b.isRepetition() || probeWDL(b, wdl);
+            b.pop();
+
+            if(!ok){
+                return false;
+            }
+            ranks.push_back(-wdl);
+        }
+    }
+
+    int best = *std::max_element(ranks.begin(), ranks.end());
+    std::vector<Move> kept;
+    for(size_t i = 0; i < moves.size(); i++){
+        if(ranks[i] == best){
+            kept.push_back(moves[i]);
+        }
+    }
+    moves = kept;
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "move.h"
+
+class Board;
+
+// Win/draw/loss from the side to move's point of view. Cursed wins and
+// blessed losses are decided by the fifty move rule.
+const int TB_LOSS = -2;
+const int TB_BLESSED_LOSS = -1;
+const int TB_DRAW = 0;
+const int TB_CURSED_WIN = 1;
+const int TB_WIN = 2;
+
+// Maps every Syzygy .rtbw and .rtbz file found in the given directories,
+// separated by ':', replacing tables mapped before. Returns the number of
+// WDL tables found.
+int initTablebases(const std::string& paths);
+
+// Most pieces of any mapped WDL table, 0 when there are none
+int tablebaseLargest();
+
+// Probes need a position without castling rights with at most
+// tablebaseLargest() pieces. The board is searched one ply deep for
+// captures and restored before returning; false when a table is missing.
+bool probeWDL(Board& b, int& wdl);
+
+// Plies to the next capture or pawn move with best play, positive when
+// the side to move wins, 100 more for cursed wins and blessed losses
+bool probeDTZ(Board& b, int& dtz);
+
+// Keeps the root moves that preserve the tablebase result, by DTZ when
+// the tables are there and otherwise by WDL. Moves completing a threefold
+// repetition of the pushed moves count as draws. Returns false and leaves
+// the moves alone when the position cannot be probed.
+bool filterRootMoves(Board& b, std::vector<Move>& moves);
@@ -0,0 +1,93 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(){
+    job_id = 0;
+    running = 0;
+    quit = false;
+}
+
+ThreadPool::~ThreadPool(){
+    stopWorkers();
+}
+
+void ThreadPool::stopWorkers(){
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    start_cv.notify_all();
+
+    for(auto& worker: workers){
+        worker.join();
+    }
+    workers.clear();
+
+    quit = false;
+}
+
+// Only changes the pool when the size differs, threads are otherwise kept
+void ThreadPool::resize(int n){
+    if(n == (int)workers.size()){
+        return;
+    }
+
+    stopWorkers();
+
+    for(int i = 0; i < n; i++){
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i, job_id));
+    }
+}
+
+int ThreadPool::size() const{
+    return workers.size();
+}
+
+void ThreadPool::run(const std::function<void(int)>& f){
+    if(workers.empty()){
+        return;
+    }
+
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = f;
+        job_id++;
+        running = workers.size();
+    }
+    start_cv.notify_all();
+}
+
+void ThreadPool::wait(){
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this]{ return running == 0; });
+}
+
+// last_job is the job id when the worker was created, so it waits for the next one
+void ThreadPool::workerLoop(int index, uint64_t last_job){
+
+    while(true){
+        std::function<void(int)> f;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [&]{ return quit || job_id != last_job; });
+
+            if(quit){
+                return;
+            }
+
+            last_job = job_id;
+            f = job;
+        }
+
+        f(index);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+        }
+        done_cv.notify_all();
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that sleep between jobs, so starting a
+// search never has to create threads. run() hands every worker the same
+// job, called with the worker's index, and wait() blocks until all of
+// them have returned from it.
+class ThreadPool{
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+
+    std::function<void(int)> job;
+    uint64_t job_id;
+    int running;
+    bool quit;
+
+    void workerLoop(int index, uint64_t last_job);
+    void stopWorkers();
+
+    public:
+        ThreadPool();
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator = (const ThreadPool&) = delete;
+
+        void resize(int n);
+        int size() const;
+
+        void run(const std::function<void(int)>& f);
+        void wait();
+};
@@ -0,0 +1,105 @@
+#include "timeman.h"
+
+#include <algorithm>
+#include <sstream>
+
+// time kept back for engine and GUI communication lag
+const int MOVE_OVERHEAD = 30;
+
+// moves left in the game when the time control doesn't say
+const int DEFAULT_MOVES_TO_GO = 30;
+
+TimeBudget allocateTime(const SearchLimits& limits, Color turn){
+    TimeBudget budget;
+
+    if(limits.movetime > 0){
+        budget.soft_ms = std::max(1, limits.movetime - MOVE_OVERHEAD);
+        budget.hard_ms = budget.soft_ms;
+        return budget;
+    }
+
+    int time = (turn == WHITE) ? limits.wtime : limits.btime;
+    int inc = (turn == WHITE) ? limits.winc : limits.binc;
+
+    if(time <= 0){
+        budget.soft_ms = -1;
+        budget.hard_ms = -1;
+        return budget;
+    }
+
+    int moves_to_go = (limits.movestogo > 0) ? limits.movestogo : DEFAULT_MOVES_TO_GO;
+    int available = std::max(1, time - MOVE_OVERHEAD);
+
+    int soft = available / moves_to_go + inc * 3 / 4;
+
+    // never risk more than three quarters of the clock on one move
+    int hard = std::min(soft * 4, available * 3 / 4);
+
+    budget.soft_ms = std::max(1, std::min(soft, hard));
+    budget.hard_ms = std::max(1, hard);
+    return budget;
+}
+
+LatencyHistogram move_latency;
+
+LatencyHistogram::LatencyHistogram(){
+    clear();
+}
+
+void LatencyHistogram::clear(){
+    for(int i = 0; i <= LATENCY_MAX_PERCENT; i++){
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    samples.store(0, std::memory_order_relaxed);
+    max_overshoot_ms.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::record(int elapsed_ms, int budget_ms){
+    if(budget_ms <= 0){
+        return;
+    }
+
+    int percent = std::min((int)((int64_t)elapsed_ms * 100 / budget_ms), LATENCY_MAX_PERCENT);
+    buckets[percent].fetch_add(1, std::memory_order_relaxed);
+    samples.fetch_add(1, std::memory_order_relaxed);
+
+    int overshoot = elapsed_ms - budget_ms;
+    int current = max_overshoot_ms.load(std::memory_order_relaxed);
+    while(overshoot > current && !max_overshoot_ms.compare_exchange_weak(current, overshoot, std::memory_order_relaxed)){
+    }
+}
+
+uint64_t LatencyHistogram::count() const{
+    return samples.load(std::memory_order_relaxed);
+}
+
+int LatencyHistogram::percentile(double p) const{
+    uint64_t total = count();
+    if(total == 0){
+        return 0;
+    }
+
+    uint64_t target = std::max<uint64_t>(1, (uint64_t)(total * p / 100.0 + 0.5));
+    uint64_t seen = 0;
+    for(int i = 0; i <= LATENCY_MAX_PERCENT; i++){
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if(seen >= target){
+            return i;
+        }
+    }
+    return LATENCY_MAX_PERCENT;
+}
+
+int LatencyHistogram::maxOvershootMs() const{
+    return max_overshoot_ms.load(std::memory_order_relaxed);
+}
+
+std::string LatencyHistogram::summary() const{
+    std::ostringstream out;
+    out << "searches " << count()
+        << " latency p50 " << percentile(50)
+        << "% p90 " << percentile(90)
+        << "% p99 " << percentile(99)
+        << "% of budget, max overshoot " << maxOvershootMs() << " ms";
+    return out.str();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "constants.h"
+
+// Limits for a single search, as given to a UCI go command. Times are in
+// milliseconds and a value of 0 means the limit is not set.
+struct SearchLimits{
+    int wtime = 0;
+    int btime = 0;
+    int winc = 0;
+    int binc = 0;
+    int movestogo = 0;
+    int movetime = 0;
+    int depth = 0;
+
+    // nodes over all search threads, 0 for no limit
+    uint64_t nodes = 0;
+
+    // search on the opponent's time, limits apply only after a ponderhit
+    bool ponder = false;
+};
+
+// No new iteration is started after soft_ms and the running one is
+// abandoned at hard_ms. Both are -1 when the search has no time limit.
+struct TimeBudget{
+    int soft_ms;
+    int hard_ms;
+};
+
+TimeBudget allocateTime(const SearchLimits& limits, Color turn);
+
+// How long searches took against their hard limit, in 1% buckets up to
+// LATENCY_MAX_PERCENT; slower searches all go in the last bucket. Safe to
+// record from several threads.
+const int LATENCY_MAX_PERCENT = 300;
+
+class LatencyHistogram{
+    std::atomic<uint64_t> buckets[LATENCY_MAX_PERCENT + 1];
+    std::atomic<uint64_t> samples;
+    std::atomic<int> max_overshoot_ms;
+
+    public:
+        LatencyHistogram();
+
+        void clear();
+        void record(int elapsed_ms, int budget_ms);
+
+        uint64_t count() const;
+
+        // smallest percentage of the budget that p percent of searches stayed within
+        int percentile(double p) const;
+        int maxOvershootMs() const;
+
+        std::string summary() const;
+};
+
+extern LatencyHistogram move_latency;
@@ -0,0 +1,250 @@
+#include "tt.h"
+#include "memory.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+TranspositionTable::TranspositionTable(size_t mb, bool lock){
+    slots = nullptr;
+    num_slots = 0;
+    mask = 0;
+    lock_pages = lock;
+    generation = 0;
+
+    file_mapping = nullptr;
+    file_mapping_size = 0;
+
+    resize(mb);
+}
+
+TranspositionTable::~TranspositionTable(){
+    release();
+}
+
+void TranspositionTable::release(){
+#if defined(__unix__) || defined(__APPLE__)
+    if(file_mapping){
+        munmap(file_mapping, file_mapping_size);
+        file_mapping = nullptr;
+        file_mapping_size = 0;
+        slots = nullptr;
+        num_slots = 0;
+        return;
+    }
+#endif
+    freeLarge(slots, num_slots * sizeof(Slot));
+    slots = nullptr;
+    num_slots = 0;
+}
+
+// Round the table down to a power of two number of slots so the index is a mask
+void TranspositionTable::resize(size_t mb){
+    size_t target = (mb * 1024 * 1024) / sizeof(Slot);
+
+    size_t count = 1;
+    while(count * 2 <= target){
+        count *= 2;
+    }
+
+    // allocate before letting go of the old table, which stays usable when
+    // the new one does not fit
+    Slot* new_slots = (Slot*)allocLarge(count * sizeof(Slot), lock_pages);
+    if(!new_slots){
+        throw std::bad_alloc();
+    }
+
+    release();
+
+    slots = new_slots;
+    num_slots = count;
+    mask = count - 1;
+
+    clear();
+}
+
+void TranspositionTable::clear(){
+    for(size_t i = 0; i < num_slots; i++){
+        slots[i].check.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+    generation = 0;
+}
+
+// Entries written before the last call are preferred for replacement
+void TranspositionTable::newSearch(){
+    generation = (generation + 1) & 63;
+}
+
+bool TranspositionTable::save(const std::string& path, uint64_t key_scheme) const{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file){
+        return false;
+    }
+
+    char header_page[TT_FILE_HEADER_SIZE] = {};
+
+    TTFileHeader header;
+    std::memcpy(header.magic, TT_FILE_MAGIC, sizeof(header.magic));
+    header.version = TT_FILE_VERSION;
+    header.slot_size = sizeof(Slot);
+    header.key_scheme = key_scheme;
+    header.num_slots = num_slots;
+    header.generation = generation;
+    std::memcpy(header_page, &header, sizeof(header));
+
+    file.write(header_page, TT_FILE_HEADER_SIZE);
+    file.write((const char*)slots, num_slots * sizeof(Slot));
+
+    return (bool)file;
+}
+
+// Replaces the table with the dump at path. Files that are truncated, from
+// another version or built with different zobrist keys leave the table as is.
+bool TranspositionTable::load(const std::string& path, uint64_t key_scheme){
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < TT_FILE_HEADER_SIZE){
+        close(fd);
+        return false;
+    }
+
+    TTFileHeader header;
+    if(pread(fd, &header, sizeof(header), 0) != sizeof(header)){
+        close(fd);
+        return false;
+    }
+
+    // the slot count is bounded by the file before it is multiplied, so a
+    // corrupt header cannot wrap the size check
+    uint64_t count = header.num_slots;
+    uint64_t file_slots = ((uint64_t)st.st_size - TT_FILE_HEADER_SIZE) / sizeof(Slot);
+    bool valid = std::memcmp(header.magic, TT_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == TT_FILE_VERSION &&
+                 header.slot_size == sizeof(Slot) &&
+                 header.key_scheme == key_scheme &&
+                 count != 0 && (count & (count - 1)) == 0 &&
+                 count <= file_slots &&
+                 (uint64_t)st.st_size == TT_FILE_HEADER_SIZE + count * sizeof(Slot);
+
+    if(!valid){
+        close(fd);
+        return false;
+    }
+
+    // private mapping: the search writes to it but never back to the file
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void* mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    close(fd);
+
+    if(mem == MAP_FAILED){
+        return false;
+    }
+
+    release();
+
+    file_mapping = mem;
+    file_mapping_size = st.st_size;
+
+    slots = (Slot*)((uint8_t*)mem + TT_FILE_HEADER_SIZE);
+    num_slots = count;
+    mask = count - 1;
+    generation = header.generation & 63;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+// 16 bit move: bits 0-5 from, 6-11 to, 12-14 promotion, 15 set if there is a move
+uint16_t TranspositionTable::packMove(const Move& move){
+    if(move.from_square >= 64 || move.to_square >= 64){
+        return 0;
+    }
+    return 0x8000 | (move.promotion & 7) << 12 | move.to_square << 6 | move.from_square;
+}
+
+Move TranspositionTable::unpackMove(uint16_t data){
+    if(!(data & 0x8000)){
+        return NO_MOVE;
+    }
+    return Move(data & 63, (data >> 6) & 63, (data >> 12) & 7);
+}
+
+// bits 0-31 value, 32-39 depth, 40-41 flag, 42-47 generation, 48-63 move
+uint64_t TranspositionTable::pack(const TTEntry& entry){
+    return (uint64_t)(uint32_t)entry.value |
+           (uint64_t)entry.depth << 32 |
+           (uint64_t)(entry.flag & 3) << 40 |
+           (uint64_t)packMove(entry.move) << 48;
+}
+
+TTEntry TranspositionTable::unpack(uint64_t data){
+    TTEntry entry;
+    entry.value = (int)(uint32_t)data;
+    entry.depth = (data >> 32) & 0xff;
+    entry.flag = (data >> 40) & 3;
+    entry.move = unpackMove(data >> 48);
+    return entry;
+}
+
+// Start loading the slot for key into cache ahead of the probe
+void TranspositionTable::prefetch(uint64_t key) const{
+    __builtin_prefetch(&slots[key & mask]);
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const{
+    const Slot& slot = slots[key & mask];
+
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+
+    // an empty slot or one torn by a concurrent store fails this check
+    if((check ^ data) != key || (check | data) == 0){
+        return false;
+    }
+
+    entry = unpack(data);
+    return true;
+}
+
+// Returns true when the entry of a different position had to make room
+bool TranspositionTable::store(uint64_t key, const TTEntry& entry){
+    Slot& slot = slots[key & mask];
+
+    // keep a deeper entry for another position written during this search
+    uint64_t old_check = slot.check.load(std::memory_order_relaxed);
+    uint64_t old_data = slot.data.load(std::memory_order_relaxed);
+    bool other_position = (old_check ^ old_data) != key && (old_check | old_data) != 0;
+    if(other_position && ((old_data >> 42) & 63) == generation && ((old_data >> 32) & 0xff) > entry.depth){
+        return false;
+    }
+
+    uint64_t data = pack(entry) | (uint64_t)generation << 42;
+
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+
+    return other_position;
+}
+
+size_t TranspositionTable::size() const{
+    return num_slots;
+}
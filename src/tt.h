@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "move.h"
+
+const uint8_t LOWER_BOUND = 0;
+const uint8_t EXACT = 1;
+const uint8_t UPPER_BOUND = 2;
+
+// Dump files are a page sized header followed by the raw slot array, so a
+// loaded file is mapped and used as the live table without parsing.
+// Version 2 stores mate and tablebase scores relative to the node, version
+// 1 dumps held them relative to the root and are rejected.
+const char TT_FILE_MAGIC[8] = {'C', 'E', 'T', 'T', 'D', 'U', 'M', 'P'};
+const uint32_t TT_FILE_VERSION = 2;
+const size_t TT_FILE_HEADER_SIZE = 4096;
+
+struct TTFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t key_scheme;
+    uint64_t num_slots;
+    uint64_t generation;
+};
+
+struct TTEntry {
+    int value;
+    uint8_t flag;
+    uint8_t depth;
+    Move move = NO_MOVE;
+};
+
+// Transposition table shared by every search thread without locking.
+// Each slot keeps the packed entry next to (key ^ entry); a probe only
+// accepts the slot when the two words recombine to the probed key, so
+// torn or interleaved writes from other threads are detected and dropped.
+class TranspositionTable{
+    struct Slot{
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    Slot* slots;
+    size_t num_slots;
+    size_t mask;
+    bool lock_pages;
+
+    uint8_t generation;
+
+    // set when slots point into a mapped dump file instead of allocLarge memory
+    void* file_mapping;
+    size_t file_mapping_size;
+
+    void release();
+
+    static uint16_t packMove(const Move& move);
+    static Move unpackMove(uint16_t data);
+
+    static uint64_t pack(const TTEntry& entry);
+    static TTEntry unpack(uint64_t data);
+
+    public:
+        TranspositionTable(size_t mb, bool lock = false);
+        ~TranspositionTable();
+
+        TranspositionTable(const TranspositionTable&) = delete;
+        TranspositionTable& operator = (const TranspositionTable&) = delete;
+
+        void resize(size_t mb);
+        void clear();
+
+        void newSearch();
+
+        bool save(const std::string& path, uint64_t key_scheme) const;
+        bool load(const std::string& path, uint64_t key_scheme);
+
+        void prefetch(uint64_t key) const;
+        bool probe(uint64_t key, TTEntry& entry) const;
+        bool store(uint64_t key, const TTEntry& entry);
+
+        size_t size() const;
+};
@@ -0,0 +1,61 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "tuner.h"
+
+using namespace std;
+
+// Fits the material and piece-square values of evaluation() to game
+// results and writes them as a new positiontables.h:
+//   texel-tuner <positions.epd> [output.h] [epochs] [threads]
+int main(int argc, char* argv[]){
+    if(argc < 2){
+        cout << "usage: texel-tuner <positions.epd> [output.h] [epochs] [threads]" << endl;
+        return 1;
+    }
+
+    string output = argc > 2 ? argv[2] : "positiontables.h";
+
+    TuningOptions options;
+    options.threads = max(1u, thread::hardware_concurrency());
+    if(argc > 3){
+        options.epochs = stoi(argv[3]);
+    }
+    if(argc > 4){
+        options.threads = stoi(argv[4]);
+    }
+
+    auto start = chrono::steady_clock::now();
+
+    TuningSet set;
+    int64_t loaded = loadTuningSet(argv[1], set);
+    if(loaded < 0){
+        cout << "Could not open " << argv[1] << endl;
+        return 1;
+    }
+
+    size_t bytes = set.pieces.size() * sizeof(uint16_t) + set.size() * 3;
+    cout << "Loaded " << loaded << " positions, " << bytes / (1024 * 1024) << " MB, in "
+         << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+    if(loaded == 0){
+        return 1;
+    }
+
+    TuningParams params = currentParams();
+    double k = fitScalingConstant(set, params, options.threads);
+    cout << "k " << k << " error " << tuningError(set, params, k, options.threads) << endl;
+
+    tune(set, params, k, options);
+    cout << "final error " << tuningError(set, params, k, options.threads) << endl;
+
+    string comment = "tuned on " + to_string(loaded) + " positions from " + string(argv[1]);
+    if(!writeTables(output, params, comment)){
+        cout << "Could not write " << output << endl;
+        return 1;
+    }
+    cout << "Wrote " << output << endl;
+
+    return 0;
+}
@@ -0,0 +1,352 @@
+#include "tuner.h"
+#include "constants.h"
+#include "positiontables.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+size_t TuningSet::size() const{
+    return results.size();
+}
+
+// Pieces of one FEN placement field as tuning features, seen from the
+// side to move. Returns false on a malformed field.
+bool placementFeatures(const std::string& placement, Color turn, std::vector<uint16_t>& features, int& phase){
+    const std::string piece_chars = "pnbrqk";
+
+    int rank = 7;
+    int file = 0;
+    for(char c: placement){
+        if(c == '/'){
+            rank--;
+            file = 0;
+        } else if (c >= '1' && c <= '8'){
+            file += c - '0';
+        } else {
+            size_t piece = piece_chars.find(std::tolower(c));
+            if(piece == std::string::npos || rank < 0 || file > 7 || features.size() == 32){
+                return false;
+            }
+
+            Color color = std::isupper(c) ? WHITE : BLACK;
+            Square square = rank * 8 + file;
+
+            // evaluation() reads the tables from h8 for the side to move
+            int index = (color == turn) ? 63 - square : square;
+            features.push_back((uint16_t)(piece * 64 + index) | (color == turn ? 0 : TUNE_THEM));
+            phase += phase_weights[piece + PAWN];
+            file++;
+        }
+    }
+    return rank == 0 && file == 8;
+}
+
+// Result in half points for white, -1 when the text has none
+int parseResult(const std::string& text){
+    if(text.find("1/2-1/2") != std::string::npos || text.find("[0.5]") != std::string::npos){
+        return 1;
+    }
+    if(text.find("1-0") != std::string::npos || text.find("[1.0]") != std::string::npos){
+        return 2;
+    }
+    if(text.find("0-1") != std::string::npos || text.find("[0.0]") != std::string::npos){
+        return 0;
+    }
+    return -1;
+}
+
+int64_t loadTuningSet(const std::string& path, TuningSet& set){
+    std::ifstream file(path);
+    if(!file){
+        return -1;
+    }
+
+    int64_t added = 0;
+    std::vector<uint16_t> features;
+    std::string line;
+    while(std::getline(file, line)){
+        // placement, side to move, castling and en passant come first
+        size_t fields_end = 0;
+        for(int i = 0; i < 4 && fields_end != std::string::npos; i++){
+            fields_end = line.find(' ', fields_end + (i > 0));
+        }
+        size_t turn_pos = line.find(' ');
+        if(fields_end == std::string::npos || turn_pos + 1 >= line.size()){
+            continue;
+        }
+
+        int result = parseResult(line.substr(fields_end));
+        if(result < 0){
+            continue;
+        }
+
+        Color turn = line[turn_pos + 1] == 'b' ? BLACK : WHITE;
+        int phase = 0;
+        features.clear();
+        if(!placementFeatures(line.substr(0, turn_pos), turn, features, phase)){
+            continue;
+        }
+
+        set.pieces.insert(set.pieces.end(), features.begin(), features.end());
+        set.piece_counts.push_back(features.size());
+        set.phases.push_back(std::min(phase, 24));
+        set.results.push_back(turn == WHITE ? result : 2 - result);
+        added++;
+    }
+    return added;
+}
+
+TuningParams currentParams(){
+    const int16_t* mg_tables[6] = {mg_pawn_table, mg_knight_table, mg_bishop_table, mg_rook_table, mg_queen_table, mg_king_table};
+    const int16_t* eg_tables[6] = {eg_pawn_table, eg_knight_table, eg_bishop_table, eg_rook_table, eg_queen_table, eg_king_table};
+
+    TuningParams params;
+    for(int piece = 0; piece < 6; piece++){
+        for(int index = 0; index < 64; index++){
+            params.mg[piece * 64 + index] = mg_tables[piece][index];
+            params.eg[piece * 64 + index] = eg_tables[piece][index];
+        }
+        params.mg[TUNE_TABLE_TERMS + piece] = mg_material[piece + PAWN];
+        params.eg[TUNE_TABLE_TERMS + piece] = eg_material[piece + PAWN];
+    }
+    return params;
+}
+
+// Positions [begin, end) of one thread, whose features start at offset
+struct TuningChunk{
+    size_t begin;
+    size_t end;
+    size_t offset;
+};
+
+std::vector<TuningChunk> splitSet(const TuningSet& set, int threads){
+    std::vector<TuningChunk> chunks;
+
+    size_t offset = 0;
+    size_t begin = 0;
+    for(int t = 0; t < threads; t++){
+        size_t end = set.size() * (t + 1) / threads;
+        chunks.push_back(TuningChunk{begin, end, offset});
+        for(size_t i = begin; i < end; i++){
+            offset += set.piece_counts[i];
+        }
+        begin = end;
+    }
+    return chunks;
+}
+
+inline double winProbability(double score, double k){
+    return 1.0 / (1.0 + std::pow(10.0, -k * score / 400.0));
+}
+
+// Squared error summed over the chunk; when gradients are given, also
+// adds the error's gradient up to a constant factor, which Adam ignores
+double chunkError(const TuningSet& set, const TuningParams& params, double k, const TuningChunk& chunk, double* mg_gradient, double* eg_gradient){
+    double error = 0.0;
+
+    size_t offset = chunk.offset;
+    for(size_t i = chunk.begin; i < chunk.end; i++){
+        const uint16_t* pieces = &set.pieces[offset];
+        int count = set.piece_counts[i];
+        offset += count;
+
+        double mg = 0.0;
+        double eg = 0.0;
+        for(int j = 0; j < count; j++){
+            int term = pieces[j] & ~TUNE_THEM;
+            int material = TUNE_TABLE_TERMS + term / 64;
+            double sign = (pieces[j] & TUNE_THEM) ? -1.0 : 1.0;
+            mg += sign * (params.mg[term] + params.mg[material]);
+            eg += sign * (params.eg[term] + params.eg[material]);
+        }
+
+        double mg_phase = set.phases[i] / 24.0;
+        double eg_phase = 1.0 - mg_phase;
+        double probability = winProbability(mg * mg_phase + eg * eg_phase, k);
+        double difference = set.results[i] / 2.0 - probability;
+        error += difference * difference;
+
+        if(!mg_gradient){
+            continue;
+        }
+
+        double gradient = -difference * probability * (1.0 - probability);
+        for(int j = 0; j < count; j++){
+            int term = pieces[j] & ~TUNE_THEM;
+            int material = TUNE_TABLE_TERMS + term / 64;
+            double sign = (pieces[j] & TUNE_THEM) ? -gradient : gradient;
+            mg_gradient[term] += sign * mg_phase;
+            mg_gradient[material] += sign * mg_phase;
+            eg_gradient[term] += sign * eg_phase;
+            eg_gradient[material] += sign * eg_phase;
+        }
+    }
+    return error;
+}
+
+// Mean error over the set and, if asked for, the summed gradient
+double setError(const TuningSet& set, const TuningParams& params, double k, ThreadPool& pool, const std::vector<TuningChunk>& chunks, TuningParams* gradient){
+    std::vector<double> errors(chunks.size(), 0.0);
+    std::vector<TuningParams> gradients(gradient ? chunks.size() : 0);
+
+    pool.run([&](int index){
+        double* mg_gradient = nullptr;
+        double* eg_gradient = nullptr;
+        if(gradient){
+            std::fill(gradients[index].mg, gradients[index].mg + TUNE_TERMS, 0.0);
+            std::fill(gradients[index].eg, gradients[index].eg + TUNE_TERMS, 0.0);
+            mg_gradient = gradients[index].mg;
+            eg_gradient = gradients[index].eg;
+        }
+        errors[index] = chunkError(set, params, k, chunks[index], mg_gradient, eg_gradient);
+    });
+    pool.wait();
+
+    if(gradient){
+        for(int term = 0; term < TUNE_TERMS; term++){
+            gradient->mg[term] = 0.0;
+            gradient->eg[term] = 0.0;
+            for(auto& g: gradients){
+                gradient->mg[term] += g.mg[term];
+                gradient->eg[term] += g.eg[term];
+            }
+        }
+    }
+
+    double error = 0.0;
+    for(double e: errors){
+        error += e;
+    }
+    return set.size() ? error / set.size() : 0.0;
+}
+
+double tuningError(const TuningSet& set, const TuningParams& params, double k, int threads){
+    ThreadPool pool;
+    pool.resize(std::max(1, threads));
+    return setError(set, params, k, pool, splitSet(set, pool.size()), nullptr);
+}
+
+// Local search in ever finer steps, the error is smooth in k
+double fitScalingConstant(const TuningSet& set, const TuningParams& params, int threads){
+    ThreadPool pool;
+    pool.resize(std::max(1, threads));
+    std::vector<TuningChunk> chunks = splitSet(set, pool.size());
+
+    double k = 1.0;
+    double best = setError(set, params, k, pool, chunks, nullptr);
+    for(double step = 0.1; step >= 0.0005; step /= 10){
+        for(int direction: {1, -1}){
+            while(k + direction * step > 0){
+                double error = setError(set, params, k + direction * step, pool, chunks, nullptr);
+                if(error >= best){
+                    break;
+                }
+                best = error;
+                k += direction * step;
+            }
+        }
+    }
+    return k;
+}
+
+void tune(const TuningSet& set, TuningParams& params, double k, const TuningOptions& options){
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    const double epsilon = 1e-8;
+
+    ThreadPool pool;
+    pool.resize(std::max(1, options.threads));
+    std::vector<TuningChunk> chunks = splitSet(set, pool.size());
+
+    TuningParams gradient;
+    TuningParams momentum = {};
+    TuningParams velocity = {};
+
+    for(int epoch = 1; epoch <= options.epochs; epoch++){
+        double error = setError(set, params, k, pool, chunks, &gradient);
+        if(options.report_interval > 0 && (epoch == 1 || epoch % options.report_interval == 0)){
+            std::cout << "epoch " << epoch << " error " << error << std::endl;
+        }
+
+        double correction1 = 1.0 - std::pow(beta1, epoch);
+        double correction2 = 1.0 - std::pow(beta2, epoch);
+
+        double* values[2] = {params.mg, params.eg};
+        double* gradients[2] = {gradient.mg, gradient.eg};
+        double* momenta[2] = {momentum.mg, momentum.eg};
+        double* velocities[2] = {velocity.mg, velocity.eg};
+        for(int part = 0; part < 2; part++){
+            for(int term = 0; term < TUNE_TERMS; term++){
+                double g = gradients[part][term];
+                momenta[part][term] = beta1 * momenta[part][term] + (1.0 - beta1) * g;
+                velocities[part][term] = beta2 * velocities[part][term] + (1.0 - beta2) * g * g;
+
+                double m = momenta[part][term] / correction1;
+                double v = velocities[part][term] / correction2;
+                values[part][term] -= options.learning_rate * m / (std::sqrt(v) + epsilon);
+            }
+        }
+    }
+}
+
+long roundedValue(double value){
+    return std::lround(std::clamp(value, -32768.0, 32767.0));
+}
+
+void writeMaterial(std::ofstream& out, const std::string& name, const double* values){
+    out << "const int16_t " << name << "[7] = {";
+    for(int i = 0; i < 7; i++){
+        out << (i ? ", " : "") << roundedValue(values[i]);
+    }
+    out << "};\n";
+}
+
+void writeTable(std::ofstream& out, const std::string& name, const double* values){
+    out << "\nconst int16_t " << name << "[64] = {\n";
+    for(int row = 0; row < 8; row++){
+        out << "   ";
+        for(int i = 0; i < 8; i++){
+            char text[16];
+            snprintf(text, sizeof(text), " %4ld,", roundedValue(values[row * 8 + i]));
+            out << text;
+        }
+        out << "\n";
+    }
+    out << "};\n";
+}
+
+bool writeTables(const std::string& path, const TuningParams& params, const std::string& comment){
+    std::ofstream out(path);
+    if(!out){
+        return false;
+    }
+
+    const char* names[6] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+
+    double mg_material_values[7] = {0};
+    double eg_material_values[7] = {0};
+    double phase_values[7];
+    for(int piece = 0; piece < 6; piece++){
+        mg_material_values[piece + PAWN] = params.mg[TUNE_TABLE_TERMS + piece];
+        eg_material_values[piece + PAWN] = params.eg[TUNE_TABLE_TERMS + piece];
+    }
+    std::copy(phase_weights, phase_weights + 7, phase_values);
+
+    out << "/* material and game phase weights, indexed by piece type */\n";
+    writeMaterial(out, "mg_material", mg_material_values);
+    writeMaterial(out, "eg_material", eg_material_values);
+    writeMaterial(out, "phase_weights", phase_values);
+
+    out << "\n/* piece/sq tables */\n/* " << comment << " */\n";
+    for(int piece = 0; piece < 6; piece++){
+        writeTable(out, std::string("mg_") + names[piece] + "_table", &params.mg[piece * 64]);
+        writeTable(out, std::string("eg_") + names[piece] + "_table", &params.eg[piece * 64]);
+    }
+
+    return (bool)out;
+}
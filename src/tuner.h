@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Terms of evaluation() the tuner fits: one piece-square entry per piece
+// type and table index, then the material value of each piece type, all
+// once for the middlegame and once for the endgame.
+const int TUNE_TABLE_TERMS = 6 * 64;
+const int TUNE_TERMS = TUNE_TABLE_TERMS + 6;
+
+// Labelled positions stored as sparse feature vectors. Every piece is one
+// uint16: (piecetype - PAWN) * 64 + the table index evaluation() reads for
+// it, with TUNE_THEM set for pieces of the side not to move.
+struct TuningSet{
+    std::vector<uint16_t> pieces;
+    std::vector<uint8_t> piece_counts;
+
+    // game phase clamped to 0..24 and the result in half points for the
+    // side to move
+    std::vector<uint8_t> phases;
+    std::vector<uint8_t> results;
+
+    size_t size() const;
+};
+
+const uint16_t TUNE_THEM = 0x8000;
+
+struct TuningParams{
+    double mg[TUNE_TERMS];
+    double eg[TUNE_TERMS];
+};
+
+struct TuningOptions{
+    int threads = 1;
+    int epochs = 1000;
+    double learning_rate = 1.0;
+
+    // print the error every this many epochs, 0 for never
+    int report_interval = 50;
+};
+
+// Reads one position per line: an EPD or FEN followed by the game result
+// as 1-0, 0-1, 1/2-1/2 or [1.0], [0.5], [0.0], for example in a c9
+// opcode. Lines without a result are skipped. Returns the number of
+// positions added, or -1 when the file cannot be opened.
+int64_t loadTuningSet(const std::string& path, TuningSet& set);
+
+// Values of positiontables.h
+TuningParams currentParams();
+
+// Mean squared error between results and the evaluation mapped to a
+// winning probability by 1 / (1 + 10^(-k * score / 400))
+double tuningError(const TuningSet& set, const TuningParams& params, double k, int threads);
+
+// Scaling constant k with the least error for the given parameters
+double fitScalingConstant(const TuningSet& set, const TuningParams& params, int threads);
+
+// Full batch gradient descent with Adam, split across threads by position
+void tune(const TuningSet& set, TuningParams& params, double k, const TuningOptions& options);
+
+// Writes params rounded to integers in the layout of positiontables.h
+bool writeTables(const std::string& path, const TuningParams& params, const std::string& comment);
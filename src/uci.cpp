@@ -0,0 +1,298 @@
+#include "uci.h"
+#include "board.h"
+#include "nnue.h"
+#include "syzygy.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+const int UCI_MAX_THREADS = 256;
+const int UCI_MAX_EVAL_CACHE_KB = 65536;
+
+const std::string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct UCIState{
+    const ZobristTable& z_table;
+    TranspositionTable& transposition_table;
+
+    Board board;
+
+    SearchSignals signals;
+    std::thread search_thread;
+
+    // go infinite and go ponder may not report a best move before stop or
+    // ponderhit, even when the search ends on its own
+    std::mutex mutex;
+    std::condition_variable release_cv;
+    bool released;
+
+    // the Ponder option: whether bestmove suggests a move to ponder on
+    bool ponder;
+
+    UCIState(const ZobristTable& z_table, TranspositionTable& transposition_table)
+        : z_table(z_table), transposition_table(transposition_table){
+        released = true;
+        ponder = false;
+    }
+};
+
+// Whole lines in a single write, so they do not interleave with the
+// search thread's output
+void send(const std::string& line){
+    std::cout << (line + "\n") << std::flush;
+}
+
+// Errors in a command go to stderr, so a GUI that does not expect them on
+// stdout never sees them
+void sendError(const std::string& line){
+    std::cerr << (line + "\n") << std::flush;
+}
+
+std::string lowercase(std::string s){
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return std::tolower(c); });
+    return s;
+}
+
+void release(UCIState& state){
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.released = true;
+    state.release_cv.notify_all();
+}
+
+// Stops the running search and waits until it has reported its move
+void finishSearch(UCIState& state){
+    if(!state.search_thread.joinable()){
+        return;
+    }
+    state.signals.stop = true;
+    release(state);
+    state.search_thread.join();
+}
+
+void sendId(){
+    send("id name chess-engine");
+    send("id author chess-engine developers");
+    send("option name Hash type spin default " + std::to_string(UCI_DEFAULT_HASH_MB) + " min 1 max " + std::to_string(UCI_MAX_HASH_MB));
+    send("option name Clear Hash type button");
+    send("option name Threads type spin default 1 min 1 max " + std::to_string(UCI_MAX_THREADS));
+    send("option name Ponder type check default false");
+    send("option name EvalFile type string default <empty>");
+    send("option name UseNNUE type check default " + std::string(search_options.use_nnue ? "true" : "false"));
+    send("option name EvalCache type spin default " + std::to_string(search_options.eval_cache_kb) + " min 0 max " + std::to_string(UCI_MAX_EVAL_CACHE_KB));
+    send("option name SyzygyPath type string default <empty>");
+    send("option name SyzygyProbeDepth type spin default " + std::to_string(search_options.tb_probe_depth) + " min 1 max " + std::to_string(MAX_DEPTH));
+    send("option name SyzygyProbeLimit type spin default " + std::to_string(search_options.tb_probe_limit) + " min 0 max 7");
+    send("uciok");
+}
+
+void setOption(UCIState& state, std::istringstream& in){
+    // names and values may contain spaces: setoption name <id> [value <x>]
+    std::string token, name, value;
+    in >> token;
+    while(in >> token && token != "value"){
+        name += (name.empty() ? "" : " ") + token;
+    }
+    while(in >> token){
+        value += (value.empty() ? "" : " ") + token;
+    }
+
+    name = lowercase(name);
+    try{
+        if(name == "hash"){
+            state.transposition_table.resize(std::clamp(std::stoi(value), 1, UCI_MAX_HASH_MB));
+        } else if (name == "clear hash"){
+            state.transposition_table.clear();
+        } else if (name == "threads"){
+            search_options.threads = std::clamp(std::stoi(value), 1, UCI_MAX_THREADS);
+        } else if (name == "ponder"){
+            // pondering itself is driven by go ponder
+            state.ponder = lowercase(value) == "true";
+        } else if (name == "evalfile"){
+            if(loadNetwork(value)){
+                search_options.use_nnue = true;
+                send("info string loaded network " + value);
+            } else {
+                send("info string could not load network " + value);
+            }
+        } else if (name == "usennue"){
+            search_options.use_nnue = lowercase(value) == "true";
+        } else if (name == "evalcache"){
+            search_options.eval_cache_kb = std::clamp(std::stoi(value), 0, UCI_MAX_EVAL_CACHE_KB);
+        } else if (name == "syzygypath"){
+            int found = initTablebases(value == "<empty>" ? "" : value);
+            send("info string found " + std::to_string(found) + " tablebases");
+        } else if (name == "syzygyprobedepth"){
+            search_options.tb_probe_depth = std::clamp(std::stoi(value), 1, MAX_DEPTH);
+        } else if (name == "syzygyprobelimit"){
+            search_options.tb_probe_limit = std::clamp(std::stoi(value), 0, 7);
+        } else {
+            send("info string unknown option " + name);
+        }
+    } catch(const std::exception&){
+        send("info string invalid value for " + name);
+    }
+}
+
+// position [startpos | fen <fen>] [moves <move>...]
+// The position is only replaced when the fen and every move are valid
+void setPosition(UCIState& state, std::istringstream& in){
+    std::string token, fen;
+    in >> token;
+
+    if(token == "startpos"){
+        fen = START_FEN;
+        in >> token;
+    } else if (token == "fen"){
+        int fields = 0;
+        while(in >> token && token != "moves"){
+            fen += (fen.empty() ? "" : " ") + token;
+            fields++;
+        }
+        // clocks are optional in EPD style positions
+        if(fields == 4){
+            fen += " 0 1";
+        }
+    } else {
+        sendError("info string expected startpos or fen");
+        return;
+    }
+
+    Board board;
+    try{
+        board = Board(fen);
+    } catch(const std::exception&){
+        sendError("info string invalid fen " + fen);
+        return;
+    }
+
+    // malformed moves parse to NO_MOVE, which is never legal
+    while(in >> token){
+        Move move(token);
+        if(move == NO_MOVE || !board.isLegal(move)){
+            sendError("info string illegal move " + token + ", position unchanged");
+            return;
+        }
+        board.push(move);
+    }
+
+    state.board = board;
+}
+
+// go [wtime x] [btime x] [winc x] [binc x] [movestogo x] [movetime x]
+//    [depth x] [nodes x] [infinite] [ponder]
+void go(UCIState& state, std::istringstream& in){
+    SearchLimits limits;
+    bool infinite = false;
+
+    std::string token;
+    while(in >> token){
+        try{
+            if(token == "wtime"){
+                in >> token;
+                limits.wtime = std::stoi(token);
+            } else if (token == "btime"){
+                in >> token;
+                limits.btime = std::stoi(token);
+            } else if (token == "winc"){
+                in >> token;
+                limits.winc = std::stoi(token);
+            } else if (token == "binc"){
+                in >> token;
+                limits.binc = std::stoi(token);
+            } else if (token == "movestogo"){
+                in >> token;
+                limits.movestogo = std::stoi(token);
+            } else if (token == "movetime"){
+                in >> token;
+                limits.movetime = std::stoi(token);
+            } else if (token == "depth"){
+                in >> token;
+                limits.depth = std::stoi(token);
+            } else if (token == "nodes"){
+                in >> token;
+                limits.nodes = std::stoull(token);
+            } else if (token == "infinite"){
+                infinite = true;
+            } else if (token == "ponder"){
+                limits.ponder = true;
+            }
+        } catch(const std::exception&){
+            send("info string invalid value for " + token);
+        }
+    }
+
+    finishSearch(state);
+
+    state.signals.stop = false;
+    state.signals.ponderhit = false;
+    state.released = !infinite && !limits.ponder;
+
+    search_options.info_format = INFO_UCI;
+
+    Board board = state.board;
+    state.search_thread = std::thread([&state, board, limits]() mutable {
+        SearchInfo info;
+        std::pair<int, Move> best = searchIterative(board, limits, state.z_table, state.transposition_table, &info, &state.signals);
+
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            state.release_cv.wait(lock, [&]{ return state.released; });
+        }
+
+        std::string line = "bestmove " + (best.second == NO_MOVE ? std::string("0000") : best.second.toUCI());
+        if(state.ponder && info.pv.size() >= 2 && info.pv.at(0) == best.second){
+            line += " ponder " + info.pv.at(1).toUCI();
+        }
+        send(line);
+    });
+}
+
+void uciLoop(const ZobristTable& table, TranspositionTable& transposition_table){
+    UCIState state(table, transposition_table);
+    sendId();
+
+    std::string line;
+    while(std::getline(std::cin, line)){
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+
+        if(command == "quit"){
+            break;
+        } else if (command == "uci"){
+            sendId();
+        } else if (command == "isready"){
+            send("readyok");
+        } else if (command == "stop"){
+            state.signals.stop = true;
+            release(state);
+        } else if (command == "ponderhit"){
+            state.signals.ponderhit = true;
+            release(state);
+        } else if (command == "ucinewgame"){
+            finishSearch(state);
+            state.transposition_table.clear();
+            state.board = Board();
+        } else if (command == "position"){
+            finishSearch(state);
+            setPosition(state, in);
+        } else if (command == "setoption"){
+            finishSearch(state);
+            setOption(state, in);
+        } else if (command == "go"){
+            go(state, in);
+        } else if (command == "d"){
+            state.board.print();
+        } else if (!command.empty()){
+            send("info string unknown command " + command);
+        }
+    }
+
+    finishSearch(state);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "engine.h"
+
+const int UCI_DEFAULT_HASH_MB = 64;
+const int UCI_MAX_HASH_MB = 65536;
+
+// Speaks UCI on stdin and stdout until quit or the end of input. This
+// thread only reads and dispatches commands; go starts the search on a
+// thread of its own, so stop, ponderhit and isready are answered while it
+// runs.
+void uciLoop(const ZobristTable& table, TranspositionTable& transposition_table);
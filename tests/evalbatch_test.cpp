@@ -0,0 +1,59 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+#include "evalbatch.h"
+
+using namespace std;
+
+// Random games from these starts reach every piece type on every square
+// with both sides to move
+const char* EVAL_BATCH_STARTS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+
+const int EVAL_BATCH_GAMES = 700;
+const int EVAL_BATCH_PLIES = 120;
+
+// Every kernel up to the best this CPU has must score each position of the
+// batch as evaluation() scores the board
+int main(int argc, char* argv[]){
+    int games = argc > 1 ? stoi(argv[1]) : EVAL_BATCH_GAMES;
+
+    PositionBatch batch;
+    vector<int> expected;
+    mt19937 rng(7);
+    for(const char* fen: EVAL_BATCH_STARTS){
+        for(int game = 0; game < games; game++){
+            Board b(fen);
+            for(int ply = 0; ply < EVAL_BATCH_PLIES; ply++){
+                vector<Move> moves = b.generateLegalMoves();
+                if(moves.empty()){
+                    break;
+                }
+                b.push(moves[rng() % moves.size()]);
+                batch.add(b);
+                expected.push_back(evaluation(b));
+            }
+        }
+    }
+
+    int failures = 0;
+    for(int kernel = EVAL_KERNEL_SCALAR; kernel <= bestEvalKernel(); kernel++){
+        vector<int> scores;
+        evaluateBatch(batch, scores, kernel);
+
+        size_t mismatches = 0;
+        for(size_t i = 0; i < scores.size(); i++){
+            mismatches += scores[i] != expected[i];
+        }
+        cout << "kernel " << kernel << ": " << batch.size() << " positions, " << mismatches << " mismatches" << endl;
+        failures += mismatches != 0 || scores.size() != expected.size();
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <string>
+
+#include "engine.h"
+#include "evalcache.h"
+
+using namespace std;
+
+const char* EVAL_CACHE_TEST_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+
+const int EVAL_CACHE_TEST_DEPTH = 5;
+const int EVAL_CACHE_TEST_KB = 256;
+
+int failures = 0;
+
+void check(bool ok, const string& what){
+    if(!ok){
+        cout << "FAIL " << what << endl;
+        failures++;
+    }
+}
+
+// Slots, replacement and the disabled cache
+void checkCache(){
+    EvalCache disabled;
+    int score = 0;
+    disabled.store(12345, 7);
+    check(!disabled.enabled() && !disabled.probe(12345, score), "disabled cache misses");
+
+    EvalCache cache(1);
+    size_t slots = cache.size();
+    check(cache.enabled() && slots > 0 && (slots & (slots - 1)) == 0, "power of two slots, " + to_string(slots));
+
+    cache.store(12345, 7);
+    check(cache.probe(12345, score) && score == 7, "stored score found");
+    check(!cache.probe(12345 + 1, score), "other key misses");
+
+    // same slot, the new score replaces the old
+    cache.store(12345 + slots, -3);
+    check(cache.probe(12345 + slots, score) && score == -3, "replacing score found");
+    check(!cache.probe(12345, score), "replaced key misses");
+
+    cache.clear();
+    check(!cache.probe(12345 + slots, score), "cleared cache misses");
+}
+
+SearchInfo search(const char* fen, const ZobristTable& z_table, int eval_cache_kb, std::pair<int, Move>& best){
+    search_options.eval_cache_kb = eval_cache_kb;
+    Board b(fen);
+    TranspositionTable transposition_table(16);
+    SearchLimits limits;
+    limits.depth = EVAL_CACHE_TEST_DEPTH;
+    SearchInfo info;
+    best = searchIterative(b, limits, z_table, transposition_table, &info);
+    return info;
+}
+
+// A cached score is the score evaluation() would give, so a search with
+// the cache visits the same nodes and returns the same move, score and pv
+// as one without it
+void checkSearch(const ZobristTable& z_table){
+    for(const char* fen: EVAL_CACHE_TEST_FENS){
+        std::pair<int, Move> plain_best, cached_best;
+        SearchInfo plain = search(fen, z_table, 0, plain_best);
+        SearchInfo cached = search(fen, z_table, EVAL_CACHE_TEST_KB, cached_best);
+
+        cout << fen << ": " << plain.nodes + plain.qnodes << " nodes without the cache, " << cached.nodes + cached.qnodes << " with it";
+#ifdef SEARCH_STATS
+        cout << ", " << cached.stats.counters[STAT_EVAL_HITS] << "/" << cached.stats.counters[STAT_EVAL_PROBES] << " hits";
+        check(cached.stats.counters[STAT_EVAL_HITS] > 0, string(fen) + ": no eval cache hits");
+#endif
+        cout << endl;
+
+        check(plain.nodes == cached.nodes && plain.qnodes == cached.qnodes, string(fen) + ": node counts differ");
+        check(plain_best == cached_best && plain.pv == cached.pv, string(fen) + ": results differ");
+    }
+    search_options.eval_cache_kb = 0;
+}
+
+// The cache on its own and its effect on searches:
+//   evalcache-test
+int main(){
+    ZobristTable z_table;
+    initZobrist(z_table);
+
+    checkCache();
+    checkSearch(z_table);
+
+    cout << failures << " failures" << endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <vector>
+
+#include "bitbase.h"
+#include "board.h"
+
+using namespace std;
+
+const int SOLVER_UNKNOWN = 0;
+const int SOLVER_WIN = 1;
+const int SOLVER_DRAW = 2;
+
+// White king, black king and white pawn on any square, either side to move
+int positionIndex(Color turn, Square white_king, Square black_king, Square pawn){
+    return ((turn * 64 + white_king) * 64 + black_king) * 64 + pawn;
+}
+
+// Whether promoting just now wins: the new queen or rook cannot be taken
+// and black is not stalemated, after which the win is certain
+bool promotionWins(Board& b, const Move& move){
+    b.push(move);
+    vector<Move> replies = b.generateLegalMoves();
+    bool taken = false;
+    for(const Move& reply: replies){
+        taken |= b.isCapture(reply);
+    }
+    bool wins = !taken && (!replies.empty() || b.isCheck());
+    b.pop();
+    return wins;
+}
+
+// Solves KPK from the rules alone, with the board's move generator and
+// repeated passes until nothing changes, and compares every legal position
+// with the bitbase. The bitbase mirrors pawns on files e-h onto a-d, which
+// is checked too since the solver does not.
+int main(){
+    const int size = 2 * 64 * 64 * 64;
+    vector<int> result(size, SOLVER_UNKNOWN);
+    vector<char> legal(size, 0);
+    vector<vector<int>> successors(size);
+
+    for(int turn = 0; turn < 2; turn++){
+        for(Square pawn = 8; pawn < 56; pawn++){
+            for(Square white_king = 0; white_king < 64; white_king++){
+                for(Square black_king = 0; black_king < 64; black_king++){
+                    if(white_king == pawn || black_king == pawn || squareDistance(white_king, black_king) <= 1){
+                        continue;
+                    }
+
+                    Board b;
+                    b.clearBoard();
+                    b.setPieceAt(white_king, KING, WHITE);
+                    b.setPieceAt(black_king, KING, BLACK);
+                    b.setPieceAt(pawn, PAWN, WHITE);
+                    b.turn = turn;
+                    if(b.isAttackedBy(b.turn, b.king(b.turn ^ 1))){
+                        continue;
+                    }
+
+                    int index = positionIndex(turn, white_king, black_king, pawn);
+                    legal[index] = 1;
+
+                    vector<Move> moves = b.generateLegalMoves();
+                    if(moves.empty()){
+                        result[index] = (b.isCheck() && turn == BLACK) ? SOLVER_WIN : SOLVER_DRAW;
+                        continue;
+                    }
+
+                    for(const Move& move: moves){
+                        if(b.isCapture(move)){
+                            // only black can capture, and only the pawn
+                            result[index] = SOLVER_DRAW;
+                            break;
+                        }
+                        if(move.promotion){
+                            if((move.promotion == QUEEN || move.promotion == ROOK) && promotionWins(b, move)){
+                                result[index] = SOLVER_WIN;
+                            }
+                            continue;
+                        }
+
+                        b.push(move);
+                        successors[index].push_back(positionIndex(b.turn, b.king(WHITE), b.king(BLACK), lsb(b.pawns)));
+                        b.pop();
+                    }
+                }
+            }
+        }
+    }
+
+    // white needs one winning move, black loses when every move loses;
+    // whatever is still unknown at the end is a draw
+    bool changed = true;
+    while(changed){
+        changed = false;
+        for(int index = 0; index < size; index++){
+            if(!legal[index] || result[index] != SOLVER_UNKNOWN){
+                continue;
+            }
+
+            bool white_to_move = index >= 64 * 64 * 64;
+            bool any_win = false, all_win = true;
+            for(int successor: successors[index]){
+                any_win |= result[successor] == SOLVER_WIN;
+                all_win &= result[successor] == SOLVER_WIN;
+            }
+            if(white_to_move ? any_win : all_win){
+                result[index] = SOLVER_WIN;
+                changed = true;
+            }
+        }
+    }
+
+    int positions = 0, mismatches = 0;
+    for(int index = 0; index < size; index++){
+        if(!legal[index]){
+            continue;
+        }
+        positions++;
+
+        Color turn = index >= 64 * 64 * 64 ? WHITE : BLACK;
+        Square white_king = (index >> 12) & 63, black_king = (index >> 6) & 63, pawn = index & 63;
+
+        Board b;
+        b.clearBoard();
+        b.setPieceAt(white_king, KING, WHITE);
+        b.setPieceAt(black_king, KING, BLACK);
+        b.setPieceAt(pawn, PAWN, WHITE);
+        b.turn = turn;
+
+        if(probeKPK(b) != (result[index] == SOLVER_WIN)){
+            if(mismatches++ < 10){
+                cout << "FAIL turn " << (int)turn << " white king " << (int)white_king << " black king " << (int)black_king
+                     << " pawn " << (int)pawn << ": solver " << (result[index] == SOLVER_WIN ? "win" : "draw") << endl;
+            }
+        }
+    }
+
+    cout << positions << " positions, " << mismatches << " mismatches" << endl;
+    return mismatches ? 1 : 0;
+}
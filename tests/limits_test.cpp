@@ -0,0 +1,120 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "engine.h"
+#include "timeman.h"
+
+using namespace std;
+
+const char* LIMITS_TEST_FEN = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+
+// the search polls its limits every 2048 main search or quiescence nodes,
+// so a node budget may be passed by up to that many of each
+const uint64_t LIMITS_TEST_NODES = 20000;
+const uint64_t LIMITS_TEST_NODE_SLACK = 2 * 2048;
+
+// generous for an unoptimized build on a busy machine
+const int LIMITS_TEST_MOVETIME = 200;
+const int LIMITS_TEST_STOP_MS = 100;
+const int LIMITS_TEST_LATE_MS = 1000;
+
+int failures = 0;
+
+void check(bool ok, const string& what){
+    if(!ok){
+        cout << "FAIL " << what << endl;
+        failures++;
+    }
+}
+
+int msSince(chrono::steady_clock::time_point start){
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+}
+
+// A node budget ends the search just past it with a legal move
+void checkNodeLimit(const ZobristTable& z_table){
+    Board b(LIMITS_TEST_FEN);
+    TranspositionTable transposition_table(16);
+    SearchLimits limits;
+    limits.nodes = LIMITS_TEST_NODES;
+    SearchInfo info;
+
+    std::pair<int, Move> best = searchIterative(b, limits, z_table, transposition_table, &info);
+    uint64_t nodes = info.nodes + info.qnodes;
+    cout << "node limit " << LIMITS_TEST_NODES << ": " << nodes << " nodes" << endl;
+    check(nodes >= LIMITS_TEST_NODES && nodes < LIMITS_TEST_NODES + LIMITS_TEST_NODE_SLACK, "node limit stopped at " + to_string(nodes));
+    check(b.isLegal(best.second), "legal move under a node limit");
+}
+
+// A fixed depth search far too deep to finish still stops on the signal,
+// with a root move only if one was searched in full before the stop
+void checkStop(const ZobristTable& z_table){
+    Board b(LIMITS_TEST_FEN);
+    TranspositionTable transposition_table(16);
+    SearchSignals signals;
+
+    auto start = chrono::steady_clock::now();
+    thread stopper([&](){
+        this_thread::sleep_for(chrono::milliseconds(LIMITS_TEST_STOP_MS));
+        signals.stop = true;
+    });
+    std::pair<int, Move> best = searchRoot(b, MAX_DEPTH, z_table, transposition_table, nullptr, &signals);
+    int elapsed = msSince(start);
+    stopper.join();
+
+    cout << "stop after " << LIMITS_TEST_STOP_MS << " ms: returned after " << elapsed << " ms" << endl;
+    check(elapsed < LIMITS_TEST_STOP_MS + LIMITS_TEST_LATE_MS, "searchRoot stopped " + to_string(elapsed) + " ms after the start");
+    check(best.second == NO_MOVE || b.isLegal(best.second), "stopped searchRoot returned an illegal move");
+}
+
+// A move time is kept to within the hard deadline, and the search lands in
+// the latency histogram
+void checkMoveTime(const ZobristTable& z_table){
+    Board b(LIMITS_TEST_FEN);
+    TranspositionTable transposition_table(16);
+    SearchLimits limits;
+    limits.movetime = LIMITS_TEST_MOVETIME;
+
+    move_latency.clear();
+    auto start = chrono::steady_clock::now();
+    std::pair<int, Move> best = searchIterative(b, limits, z_table, transposition_table);
+    int elapsed = msSince(start);
+
+    cout << "movetime " << LIMITS_TEST_MOVETIME << ": " << elapsed << " ms, " << move_latency.summary() << endl;
+    check(elapsed < LIMITS_TEST_MOVETIME + LIMITS_TEST_LATE_MS, "movetime search took " + to_string(elapsed) + " ms");
+    check(b.isLegal(best.second), "legal move under a move time");
+    check(move_latency.count() == 1, "search recorded in the latency histogram");
+}
+
+// Buckets, percentiles and the largest overshoot
+void checkHistogram(){
+    LatencyHistogram histogram;
+    histogram.record(50, 100);
+    histogram.record(90, 100);
+    histogram.record(120, 100);
+    histogram.record(10, 0);
+
+    check(histogram.count() == 3, "searches without a budget are not recorded");
+    check(histogram.percentile(50) == 90, "median " + to_string(histogram.percentile(50)) + "%");
+    check(histogram.percentile(99) == 120, "p99 " + to_string(histogram.percentile(99)) + "%");
+    check(histogram.maxOvershootMs() == 20, "max overshoot " + to_string(histogram.maxOvershootMs()) + " ms");
+}
+
+// Node budgets, the stop signal, move time deadlines and the latency
+// histogram that records them:
+//   limits-test
+int main(){
+    ZobristTable z_table;
+    initZobrist(z_table);
+
+    checkNodeLimit(z_table);
+    checkStop(z_table);
+    checkMoveTime(z_table);
+    checkHistogram();
+
+    cout << failures << " failures" << endl;
+    return failures ? 1 : 0;
+}
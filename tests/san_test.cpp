@@ -0,0 +1,151 @@
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "fen.h"
+
+using namespace std;
+
+// Starts for random games: the opening, castling both ways, en passant,
+// promotions with captures, and several knights, rooks and queens that can
+// reach the same square
+const char* SAN_TEST_STARTS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "rnbqkb1r/pp1p1ppp/4pn2/2pP4/2P5/8/PP2PPPP/RNBQKBNR w KQkq c6 0 4",
+    "1r1q1r2/PPP3k1/8/8/8/K7/5ppp/6NR b - - 0 1",
+    "N3N3/8/4k3/8/N3N3/8/4K3/8 w - - 0 1",
+    "R6R/8/3k4/8/8/2K5/8/R6R w - - 0 1",
+    "Q6Q/8/3k4/8/8/2K5/8/Q6Q b - - 0 1",
+};
+
+const int SAN_TEST_GAMES = 40;
+const int SAN_TEST_PLIES = 100;
+
+// SAN written from the rules: piece letter, file, then rank, then both to
+// tell apart pieces of the same type reaching the square, x for captures,
+// =piece for promotions and + or # for checks
+string referenceSAN(Board& b, const Move& move){
+    string san;
+    if(b.isCastling(move)){
+        san = move.to_square > move.from_square ? "O-O" : "O-O-O";
+    } else {
+        PieceType piecetype = b.pieceTypeAt(move.from_square);
+        bool capture = b.isCapture(move);
+
+        if(piecetype == PAWN){
+            if(capture){
+                san += char('a' + move.from_square % 8);
+            }
+        } else {
+            san += " PNBRQK"[piecetype];
+
+            bool ambiguous = false, same_file = false, same_rank = false;
+            for(const Move& other: b.generateLegalMoves()){
+                if(other.to_square == move.to_square && other.from_square != move.from_square &&
+                   b.pieceTypeAt(other.from_square) == piecetype){
+                    ambiguous = true;
+                    same_file |= other.from_square % 8 == move.from_square % 8;
+                    same_rank |= other.from_square / 8 == move.from_square / 8;
+                }
+            }
+            if(ambiguous && (!same_file || same_rank)){
+                san += char('a' + move.from_square % 8);
+            }
+            if(ambiguous && same_file){
+                san += char('1' + move.from_square / 8);
+            }
+        }
+
+        if(capture){
+            san += 'x';
+        }
+        san += SQUARE_NAMES[move.to_square];
+        if(move.promotion){
+            san += '=';
+            san += " PNBRQK"[move.promotion];
+        }
+    }
+
+    b.push(move);
+    if(b.isCheck()){
+        san += b.isCheckmate() ? "#" : "+";
+    }
+    b.pop();
+    return san;
+}
+
+uint64_t moves_checked = 0;
+uint64_t failures = 0;
+
+// Every legal move of the position: SAN as the reference writes it, unique
+// within the position and parsed back to the move, UCI likewise
+void checkPosition(Board& b){
+    set<string> seen;
+    for(const Move& move: b.generateLegalMoves()){
+        string san = b.toSAN(move);
+        string reference = referenceSAN(b, move);
+
+        Move from_san;
+        bool parsed = b.parseSAN(san, from_san);
+        Move from_uci(move.toUCI());
+
+        moves_checked++;
+        if(san != reference || !parsed || from_san != move || from_uci != move || !seen.insert(san).second){
+            if(failures++ < 10){
+                char fen[FEN_MAX_LENGTH];
+                writeFEN(b, fen, sizeof(fen));
+                cout << "FAIL " << fen << " " << move.toUCI() << ": " << san << ", expected " << reference << endl;
+            }
+        }
+    }
+}
+
+// SAN and UCI of every legal move in positions from random games, or in
+// the FEN/EPD lines of a file:
+//   san-test [positions.epd]
+int main(int argc, char* argv[]){
+    uint64_t positions = 0;
+
+    if(argc > 1){
+        ifstream in(argv[1]);
+        if(!in){
+            cout << "Could not open " << argv[1] << endl;
+            return 1;
+        }
+        string line;
+        while(getline(in, line)){
+            Board b;
+            EPDRecord record;
+            FENError error;
+            if(parseFEN(line, b, error) || parseEPD(line, b, record, error)){
+                checkPosition(b);
+                positions++;
+            }
+        }
+    } else {
+        mt19937 rng(3);
+        for(const char* fen: SAN_TEST_STARTS){
+            for(int game = 0; game < SAN_TEST_GAMES; game++){
+                Board b(fen);
+                for(int ply = 0; ply < SAN_TEST_PLIES; ply++){
+                    checkPosition(b);
+                    positions++;
+
+                    vector<Move> moves = b.generateLegalMoves();
+                    if(moves.empty()){
+                        break;
+                    }
+                    b.push(moves[rng() % moves.size()]);
+                }
+            }
+        }
+    }
+
+    cout << positions << " positions, " << moves_checked << " moves, " << failures << " failures" << endl;
+    return failures ? 1 : 0;
+}
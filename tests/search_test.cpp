@@ -0,0 +1,92 @@
+#include <iostream>
+#include <string>
+
+#include "engine.h"
+
+using namespace std;
+
+// Fixed-depth searches of these positions visit exactly these numbers of
+// nodes, quiescence included, with one thread and a fresh 16 MB table.
+// Any change to move ordering, the PVS and aspiration logic or pruning
+// shows up here; update the counts when the change is meant to.
+struct SearchTestPosition{
+    const char* fen;
+    uint64_t nodes;
+};
+
+const SearchTestPosition SEARCH_TEST_POSITIONS[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 14899},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 134850},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 7465},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 128378},
+};
+
+const int SEARCH_TEST_DEPTH = 6;
+const int SEARCH_TEST_HASH_MB = 16;
+
+// with good ordering nearly every beta cutoff comes from the first move
+const double SEARCH_TEST_FIRST_CUTOFFS = 0.9;
+
+int failures = 0;
+
+void check(bool ok, const string& what){
+    if(!ok){
+        cout << "FAIL " << what << endl;
+        failures++;
+    }
+}
+
+SearchInfo search(const char* fen, const ZobristTable& z_table){
+    Board b(fen);
+    TranspositionTable transposition_table(SEARCH_TEST_HASH_MB);
+    SearchLimits limits;
+    limits.depth = SEARCH_TEST_DEPTH;
+    SearchInfo info;
+    searchIterative(b, limits, z_table, transposition_table, &info);
+    return info;
+}
+
+// Node counts of the fixed-depth searches, the share of cutoffs on the
+// first move when the search keeps statistics, and the same counts again
+// after Lazy SMP searches, which must leave nothing behind in the pool:
+//   search-test
+int main(){
+    ZobristTable z_table;
+    initZobrist(z_table);
+
+    uint64_t total = 0;
+    for(const SearchTestPosition& position: SEARCH_TEST_POSITIONS){
+        SearchInfo info = search(position.fen, z_table);
+        uint64_t nodes = info.nodes + info.qnodes;
+        total += nodes;
+        cout << position.fen << ": " << nodes << " nodes";
+        check(nodes == position.nodes, string(position.fen) + ": " + to_string(nodes) + " nodes, expected " + to_string(position.nodes));
+
+#ifdef SEARCH_STATS
+        uint64_t cutoffs = 0;
+        for(int i = 0; i < CUTOFF_SLOTS; i++){
+            cutoffs += info.stats.counters[STAT_CUTOFF_INDEX + i];
+        }
+        double first = cutoffs ? (double)info.stats.counters[STAT_CUTOFF_INDEX] / cutoffs : 0.0;
+        cout << ", " << first * 100 << "% of cutoffs on the first move";
+        check(first >= SEARCH_TEST_FIRST_CUTOFFS, string(position.fen) + ": " + to_string(first) + " of cutoffs on the first move");
+#endif
+        cout << endl;
+    }
+    cout << total << " nodes in total" << endl;
+
+    search_options.threads = 2;
+    for(const SearchTestPosition& position: SEARCH_TEST_POSITIONS){
+        SearchInfo info = search(position.fen, z_table);
+        check(!info.pv.empty(), string(position.fen) + ": no move with two threads");
+    }
+    search_options.threads = 1;
+
+    for(const SearchTestPosition& position: SEARCH_TEST_POSITIONS){
+        SearchInfo info = search(position.fen, z_table);
+        check(info.nodes + info.qnodes == position.nodes, string(position.fen) + ": node count changed after Lazy SMP searches");
+    }
+
+    cout << failures << " failures" << endl;
+    return failures ? 1 : 0;
+}
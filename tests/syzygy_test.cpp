@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bitbase.h"
+#include "board.h"
+#include "fen.h"
+#include "syzygy.h"
+
+using namespace std;
+
+int failures = 0;
+
+void check(bool ok, const string& what){
+    if(!ok){
+        cout << "FAIL " << what << endl;
+        failures++;
+    }
+}
+
+// A three piece WDL table where every position of a side to move holds
+// the same value, the way real tables store sides without exceptions. The
+// values ignore stalemates, so the checks below stay clear of them.
+// Layout: magic, flags, piece order, pieces of both sides in nibbles,
+// padding to an even offset, then a single value sub-table per side; the
+// file is padded to 64n + 16 bytes like every table.
+bool writeSingleValueTable(const string& path, const uint8_t pieces[3], int white_wdl, int black_wdl){
+    vector<uint8_t> data = {0x71, 0xE8, 0x23, 0x5D, 1, 0};
+    for(int i = 0; i < 3; i++){
+        data.push_back(pieces[i] | (pieces[i] << 4));
+    }
+    data.push_back(0);
+    data.insert(data.end(), {0x80, (uint8_t)(white_wdl + 2), 0x80, (uint8_t)(black_wdl + 2)});
+    data.resize(80, 0);
+
+    ofstream out(path, ios::binary);
+    out.write((const char*)data.data(), data.size());
+    return (bool)out;
+}
+
+int probe(const char* fen){
+    Board b(fen);
+    int wdl;
+    return probeWDL(b, wdl) ? wdl : -100;
+}
+
+// Plays the moves and returns what filterRootMoves keeps, empty when it
+// does not filter
+vector<Move> rootMoves(const char* fen, const vector<const char*>& moves){
+    Board b(fen);
+    for(const char* move: moves){
+        b.pushUCI(move);
+    }
+    vector<Move> legal = b.generateLegalMoves();
+    return filterRootMoves(b, legal) ? legal : vector<Move>();
+}
+
+// Decoding, material lookup for either color, the capture search and the
+// root move filter on a made up KRvK table that wins for white whoever is
+// to move
+void checkSyntheticTable(){
+    char directory[] = "/tmp/syzygy-test-XXXXXX";
+    if(!mkdtemp(directory)){
+        check(false, "temporary directory");
+        return;
+    }
+    string path = string(directory) + "/KRvK.rtbw";
+
+    // white king, black king (color bit 3 set) and white rook
+    const uint8_t pieces[3] = {KING, KING | 8, ROOK};
+    check(writeSingleValueTable(path, pieces, TB_WIN, TB_LOSS), "writing " + path);
+
+    check(initTablebases(string(directory)) == 1, "one table found");
+    check(tablebaseLargest() == 3, "largest table has 3 pieces");
+
+    check(probe("8/8/8/8/8/2k5/8/R3K3 w - - 0 1") == TB_WIN, "KRvK white to move wins");
+    check(probe("8/8/8/8/8/2k5/8/R3K3 b - - 0 1") == TB_LOSS, "KRvK black to move loses");
+    check(probe("r3k3/8/2K5/8/8/8/8/8 b - - 0 1") == TB_WIN, "KvKR black to move wins");
+    check(probe("r3k3/8/2K5/8/8/8/8/8 w - - 0 1") == TB_LOSS, "KvKR white to move loses");
+    check(probe("8/8/8/8/8/8/1k6/R3K3 b - - 0 1") == TB_DRAW, "rook taken leaves a draw");
+    check(probe("8/8/8/8/2k5/8/8/Q3K3 w - - 0 1") == -100, "KQvK has no table");
+
+    // the rook and king shuffle back and forth: Kc3 would bring the start
+    // position back a third time, the only move that does not lose
+    vector<Move> moves = rootMoves("8/8/8/8/8/2k5/8/R3K3 w - - 0 1", {"a1a2", "c3c4", "a2a1", "c4c3", "a1a2", "c3c4", "a2a1"});
+    check(moves.size() == 1 && moves.at(0) == Move(string_view("c4c3")), "losing side keeps the repetition");
+
+    // the winning side drops the move that repeats for the third time
+    Board b("8/8/8/8/8/2k5/8/R3K3 w - - 0 1");
+    for(const char* move: {"a1a2", "c3c4", "a2a1", "c4c3", "a1a2", "c3c4", "a2a1", "c4c3", "a1a2", "c3c4"}){
+        b.pushUCI(move);
+    }
+    moves = b.generateLegalMoves();
+    size_t legal = moves.size();
+    check(filterRootMoves(b, moves) && moves.size() == legal - 1 &&
+          std::find(moves.begin(), moves.end(), Move(string_view("a2a1"))) == moves.end(), "winning side avoids the repetition");
+
+    initTablebases("");
+    unlink(path.c_str());
+    rmdir(directory);
+}
+
+// The first 16 bytes of the KRvK table keep the size of a table file but end
+// before the data the header places on the next 64 byte boundary, so the
+// table must be left out rather than read past the end of the mapping
+void checkTruncatedTable(){
+    char directory[] = "/tmp/syzygy-test-XXXXXX";
+    if(!mkdtemp(directory)){
+        check(false, "temporary directory");
+        return;
+    }
+    string path = string(directory) + "/KRvK.rtbw";
+
+    const uint8_t pieces[3] = {KING, KING | 8, ROOK};
+    check(writeSingleValueTable(path, pieces, TB_WIN, TB_LOSS) && truncate(path.c_str(), 16) == 0, "writing " + path);
+
+    check(initTablebases(string(directory)) == 0, "truncated table rejected");
+    check(tablebaseLargest() == 0, "no tables after the truncated one");
+    check(probe("8/8/8/8/8/2k5/8/R3K3 w - - 0 1") == -100, "truncated table not probed");
+
+    initTablebases("");
+    unlink(path.c_str());
+    rmdir(directory);
+}
+
+// Every legal KPvK position in the real table against the KPK bitbase
+void checkKPK(const string& paths){
+    if(initTablebases(paths) == 0){
+        cout << "no tables in " << paths << endl;
+        failures++;
+        return;
+    }
+
+    int positions = 0;
+    for(int turn = 0; turn < 2; turn++){
+        for(int pawn = 8; pawn < 56; pawn++){
+            for(int white_king = 0; white_king < 64; white_king++){
+                for(int black_king = 0; black_king < 64; black_king++){
+                    if(white_king == black_king || white_king == pawn || black_king == pawn){
+                        continue;
+                    }
+
+                    char grid[64];
+                    std::fill(grid, grid + 64, '1');
+                    grid[pawn] = 'P';
+                    grid[white_king] = 'K';
+                    grid[black_king] = 'k';
+
+                    string fen;
+                    for(int rank = 7; rank >= 0; rank--){
+                        fen.append(grid + rank * 8, 8);
+                        fen += rank ? "/" : "";
+                    }
+                    fen += turn == WHITE ? " w - - 0 1" : " b - - 0 1";
+
+                    Board b;
+                    FENError error;
+                    if(!parseFEN(fen, b, error) || b.generateLegalMoves().empty()){
+                        continue;
+                    }
+
+                    int wdl;
+                    if(!probeWDL(b, wdl)){
+                        check(false, "probe of " + fen);
+                        continue;
+                    }
+                    int expected = probeKPK(b) ? (turn == WHITE ? TB_WIN : TB_LOSS) : TB_DRAW;
+                    check(wdl == expected, fen + ": table " + to_string(wdl) + ", bitbase " + to_string(expected));
+                    positions++;
+                }
+            }
+        }
+    }
+    cout << positions << " KPvK positions checked" << endl;
+}
+
+// Checks the probing code on a generated table and the rejection of a
+// truncated one, and with a directory of real tables holding KPvK also
+// every KPvK position against the bitbase:
+//   syzygy-test [<path>]
+int main(int argc, char* argv[]){
+    checkSyntheticTable();
+    checkTruncatedTable();
+
+    if(argc > 1){
+        checkKPK(argv[1]);
+    }
+
+    cout << failures << " failures" << endl;
+    return failures ? 1 : 0;
+}
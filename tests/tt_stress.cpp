@@ -0,0 +1,105 @@
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tt.h"
+
+using namespace std;
+
+// Many threads store and probe a small pool of keys on a small table, so
+// threads keep overwriting each other's slots and the same keys. Every hit
+// has to return one of the entries stored for the probed key, never a
+// mix of two stores or an entry of another key.
+//   tt-stress [threads] [operations per thread]
+
+const int KEY_COUNT = 1 << 16;
+const int VERSIONS = 4;
+const size_t TABLE_MB = 1;
+
+uint64_t mix(uint64_t x){
+    x ^= x >> 31;
+    x *= 0x7fb5d329728ea185ULL;
+    x ^= x >> 27;
+    x *= 0x81dadef4bc2dd44dULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// The entries a key can have, one per version
+TTEntry entryFor(uint64_t key, int version){
+    uint64_t h = mix(key + version);
+
+    TTEntry entry;
+    entry.value = (int)(int32_t)h;
+    entry.depth = (h >> 32) & 0xff;
+    entry.flag = (h >> 40) % 3;
+    entry.move = ((h >> 44) & 1) ? Move((h >> 45) & 63, (h >> 51) & 63) : NO_MOVE;
+    return entry;
+}
+
+bool sameEntry(const TTEntry& a, const TTEntry& b){
+    return a.value == b.value && a.depth == b.depth && a.flag == b.flag && a.move == b.move;
+}
+
+int main(int argc, char* argv[]){
+    int threads = argc > 1 ? stoi(argv[1]) : 8;
+    int operations = argc > 2 ? stoi(argv[2]) : 1000000;
+
+    vector<uint64_t> keys(KEY_COUNT);
+    mt19937_64 rng(12345);
+    for(auto& key: keys){
+        key = rng();
+    }
+
+    TranspositionTable table(TABLE_MB);
+
+    atomic<uint64_t> hits(0), misses(0), bad(0);
+
+    vector<thread> workers;
+    for(int t = 0; t < threads; t++){
+        workers.push_back(thread([&, t]{
+            mt19937_64 local(t + 1);
+            uint64_t local_hits = 0, local_misses = 0;
+
+            for(int i = 0; i < operations; i++){
+                uint64_t r = local();
+                uint64_t key = keys[r % KEY_COUNT];
+
+                if((r >> 32) & 1){
+                    table.store(key, entryFor(key, (r >> 33) % VERSIONS));
+                    continue;
+                }
+
+                TTEntry entry;
+                if(!table.probe(key, entry)){
+                    local_misses++;
+                    continue;
+                }
+                local_hits++;
+
+                bool found = false;
+                for(int version = 0; version < VERSIONS; version++){
+                    found |= sameEntry(entry, entryFor(key, version));
+                }
+                if(!found && bad.fetch_add(1) < 10){
+                    cout << "bad entry for key " << key << ": value " << entry.value << " depth " << (int)entry.depth << endl;
+                }
+            }
+
+            hits += local_hits;
+            misses += local_misses;
+        }));
+    }
+    for(auto& worker: workers){
+        worker.join();
+    }
+
+    cout << threads << " threads, " << hits << " hits, " << misses << " misses, " << bad << " bad entries" << endl;
+
+    // a run without hits would not have checked anything
+    return (bad == 0 && hits > 0) ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "tuner.h"
+
+using namespace std;
+
+// Material up and down for either side with the results it should bring,
+// in both result notations, and a line without a result that is skipped
+const char* TUNER_TEST_LINES[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 1/2-1/2",
+    "rnb1kbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1 1-0",
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RN1QKBNR w KQkq - 0 1 0-1",
+    "4k3/8/8/8/8/8/8/3QK3 w - - 0 1 1-0",
+    "3qk3/8/8/8/8/8/8/4K3 b - - 0 1 0-1",
+    "4k3/8/8/8/8/8/4P3/4K3 w - - 0 1 [1.0]",
+    "4k3/4p3/8/8/8/8/8/4K3 w - - 0 1 [0.0]",
+    "r3k3/8/8/8/8/8/8/4K2R w - - 0 1 [0.5]",
+    "4k3/pppp4/8/8/8/8/4PPPP/4K3 b - - 0 1 1/2-1/2",
+    "4k3/8/8/8/8/8/8/4K3 w - - 0 1",
+};
+
+const int TUNER_TEST_POSITIONS = 9;
+const int TUNER_TEST_EPOCHS = 20;
+
+// A few epochs of the tuner on a tiny labelled set, split across threads,
+// must lower the error it started from
+int main(){
+    char path[] = "/tmp/tuner-test-XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0){
+        cout << "FAIL temporary file" << endl;
+        return 1;
+    }
+    close(fd);
+    {
+        ofstream out(path);
+        for(const char* line: TUNER_TEST_LINES){
+            out << line << "\n";
+        }
+    }
+
+    TuningSet set;
+    int64_t loaded = loadTuningSet(path, set);
+    unlink(path);
+
+    int failures = 0;
+    if(loaded != TUNER_TEST_POSITIONS){
+        cout << "FAIL loaded " << loaded << " positions, expected " << TUNER_TEST_POSITIONS << endl;
+        failures++;
+    }
+
+    TuningOptions options;
+    options.threads = 2;
+    options.epochs = TUNER_TEST_EPOCHS;
+    options.report_interval = 0;
+
+    TuningParams params = currentParams();
+    double k = fitScalingConstant(set, params, options.threads);
+    double before = tuningError(set, params, k, options.threads);
+
+    tune(set, params, k, options);
+    double after = tuningError(set, params, k, options.threads);
+
+    cout << "k " << k << ", error " << before << " before and " << after << " after " << TUNER_TEST_EPOCHS << " epochs" << endl;
+    if(!(after < before)){
+        cout << "FAIL error did not go down" << endl;
+        failures++;
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "board.h"
+
+using namespace std;
+
+int failures = 0;
+
+void check(bool ok, const string& what){
+    if(!ok){
+        cout << "FAIL " << what << endl;
+        failures++;
+    }
+}
+
+// The engine with its stdin and stdout on pipes and stderr discarded,
+// started without arguments like a GUI that only pipes uci to it
+struct Engine{
+    pid_t pid = -1;
+    FILE* in = nullptr;
+    FILE* out = nullptr;
+
+    bool start(const char* path){
+        int to_engine[2], from_engine[2];
+        if(pipe(to_engine) != 0 || pipe(from_engine) != 0){
+            return false;
+        }
+
+        pid = fork();
+        if(pid < 0){
+            return false;
+        }
+        if(pid == 0){
+            dup2(to_engine[0], STDIN_FILENO);
+            dup2(from_engine[1], STDOUT_FILENO);
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(null_fd, STDERR_FILENO);
+            close(to_engine[1]);
+            close(from_engine[0]);
+            execl(path, path, (char*)nullptr);
+            _exit(127);
+        }
+
+        close(to_engine[0]);
+        close(from_engine[1]);
+        in = fdopen(to_engine[1], "w");
+        out = fdopen(from_engine[0], "r");
+        return in && out;
+    }
+
+    void send(const string& line){
+        fputs((line + "\n").c_str(), in);
+        fflush(in);
+    }
+
+    // Lines up to and including the first that starts with prefix, all of
+    // them when the engine closes stdout first
+    vector<string> readUntil(const string& prefix){
+        vector<string> lines;
+        char buffer[4096];
+        while(fgets(buffer, sizeof(buffer), out)){
+            string line(buffer);
+            while(!line.empty() && (line.back() == '\n' || line.back() == '\r')){
+                line.pop_back();
+            }
+            lines.push_back(line);
+            if(line.compare(0, prefix.size(), prefix) == 0){
+                break;
+            }
+        }
+        return lines;
+    }
+
+    int finish(){
+        fclose(in);
+        fclose(out);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+};
+
+bool startsWith(const vector<string>& lines, const string& prefix){
+    return !lines.empty() && lines.back().compare(0, prefix.size(), prefix) == 0;
+}
+
+bool anyStartsWith(const vector<string>& lines, const string& prefix){
+    for(const string& line: lines){
+        if(line.compare(0, prefix.size(), prefix) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+// The move of a bestmove line if it is legal in b
+bool legalBestMove(const vector<string>& lines, Board b){
+    if(!startsWith(lines, "bestmove ")){
+        return false;
+    }
+    string move = lines.back().substr(9, lines.back().find(' ', 9) - 9);
+    return b.isLegal(Move(move));
+}
+
+// A scripted session: piped uci detection, isready, position with moves,
+// go depth, a position with an illegal move that must leave the last one
+// in place, and the Ponder option and move time of go ponder:
+//   uci-test <chess-engine>
+int main(int argc, char* argv[]){
+    if(argc < 2){
+        cout << "Usage: uci-test <chess-engine>" << endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    Engine engine;
+    check(engine.start(argv[1]), "starting " + string(argv[1]));
+
+    // nothing of the console game comes before the identification
+    engine.send("uci");
+    vector<string> lines = engine.readUntil("uciok");
+    check(!lines.empty() && lines.front() == "id name chess-engine", "id name first, got " + (lines.empty() ? string() : lines.front()));
+    check(startsWith(lines, "uciok"), "uciok");
+
+    engine.send("isready");
+    check(engine.readUntil("readyok") == vector<string>{"readyok"}, "readyok");
+
+    Board after_e4_e5;
+    after_e4_e5.pushUCI("e2e4");
+    after_e4_e5.pushUCI("e7e5");
+
+    engine.send("position startpos moves e2e4 e7e5");
+    engine.send("go depth 3");
+    lines = engine.readUntil("bestmove");
+    check(anyStartsWith(lines, "info depth 3 ") && !anyStartsWith(lines, "info depth 4 "), "info up to depth 3");
+    check(legalBestMove(lines, after_e4_e5), "bestmove legal after e2e4 e7e5, got " + (lines.empty() ? string() : lines.back()));
+    check(startsWith(lines, "bestmove") && lines.back().find(" ponder ") == string::npos, "no ponder move with Ponder off");
+
+    // the second e2e4 is illegal, so the whole command is dropped rather
+    // than leaving black to move after 1. e4; the error goes to stderr
+    engine.send("position startpos moves e2e4 e2e4");
+    engine.send("isready");
+    check(engine.readUntil("readyok") == vector<string>{"readyok"}, "nothing on stdout for an illegal move");
+    engine.send("go depth 1");
+    lines = engine.readUntil("bestmove");
+    check(legalBestMove(lines, after_e4_e5), "illegal move keeps the previous position, got " + (lines.empty() ? string() : lines.back()));
+
+    // the move time of a ponder search starts with the ponderhit, not with
+    // the go ponder that came long before it
+    engine.send("setoption name Ponder value true");
+    engine.send("position startpos moves e2e4 e7e5");
+    engine.send("go ponder movetime 300");
+    this_thread::sleep_for(chrono::milliseconds(600));
+    engine.send("ponderhit");
+    auto ponderhit = chrono::steady_clock::now();
+    lines = engine.readUntil("bestmove");
+    int after_ponderhit_ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - ponderhit).count();
+    check(after_ponderhit_ms >= 150, "searched on after the ponderhit, bestmove after " + to_string(after_ponderhit_ms) + " ms");
+    check(startsWith(lines, "bestmove") && lines.back().find(" ponder ") != string::npos, "ponder move with Ponder on");
+
+    engine.send("quit");
+    check(engine.finish() == 0, "exit code");
+
+    cout << failures << " failures" << endl;
+    return failures ? 1 : 0;
+}